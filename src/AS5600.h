@@ -5,6 +5,8 @@
  *  @date 2018-Aug-22 Original file by Stoboi
  *  @date 2019-Sep-20 Modified version by Ridgely
  *  @date 2022-Aug-28 Replaced constructors with one that's given an I2C port
+ *  @date 2026-Oct-18 Made a template on the I2C port's type so the driver can
+ *        be run against a stand-in port such as @c MockI2C
  *  @copyright Original file released by Stoboi into the public domain,
  *      available at https://github.com/kanestoboi/AS5600.
  *  	Modified version with Doxygen comments and code enhancements (c) 2022
@@ -19,9 +21,12 @@
 
 
 /** This class operates an AS5600L magnetic angle sensor using an Arduino
- *  TwoWire I2C interface such as @c Wire.
+ *  TwoWire I2C interface such as @c Wire, or anything else with the same
+ *  methods. The port's type is found from the constructor's parameter, so
+ *  @c AS5600 @c angler(Wire) makes an @c AS5600<TwoWire>.
+ *  @tparam Bus The type of the I2C port, normally @c TwoWire
  */
-
+template <class Bus = TwoWire>
 class AS5600
 {
 protected:
@@ -51,10 +56,11 @@ protected:
 	uint16_t getRegisters2 (uint8_t registerMSB);
 	uint8_t getRegister (uint8_t register1);
 
-    TwoWire* p_i2c;   ///< Pointer to the I2C port to which sensor is connected
+    Bus* p_i2c;       ///< Pointer to the I2C port to which sensor is connected
+    uint8_t settle_ms;  ///< Wait between choosing and reading two registers
 
 public:
-    AS5600 (TwoWire& i2c, uint8_t address = 0x36);
+    AS5600 (Bus& i2c, uint8_t address = 0x36, uint8_t settle = 10);
 
     uint16_t getPosition (void);
     uint16_t getAngle (void);
@@ -64,5 +70,115 @@ public:
     void setZero (void);
 };
 
-#endif // _AS5600_H_
 
+/** This constructor creates an AS5600 object using the given I2C (TwoWire) 
+ *  driver, which has already been created, and the given address if given.
+ *  @param i2c An I2C object, created as TwoWire(params)
+ *  @param address The address to use for the AS5600, default 
+ *  @param settle The time in milliseconds to wait after choosing a pair of
+ *  	registers before reading them, default 10
+ */
+template <class Bus>
+AS5600<Bus>::AS5600 (Bus& i2c, uint8_t address, uint8_t settle)
+{
+    p_i2c = &i2c;
+    _AS5600Address = address;
+    settle_ms = settle;
+}
+
+
+/** This method returns the 'raw' angular position measured by the AS5600.
+ *  This unscaled and unmodified angle comes out in a 12-bit number.
+ *  @return The unscaled position
+ */
+template <class Bus>
+uint16_t AS5600<Bus>::getPosition (void)
+{
+  return getRegisters2 (_RAWANGLEAddressMSB);
+}
+
+
+/** This method returns the scaled and corrected angle measured by the AS5600.
+ *  @return Our best estimate of the actual angle, in a 12-bit integer
+ */
+template <class Bus>
+uint16_t AS5600<Bus>::getAngle (void)
+{
+  return getRegisters2 (_ANGLEAddressMSB);
+}
+
+
+template <class Bus>
+uint8_t AS5600<Bus>::getStatus (void)
+{
+  return getRegister (_STATUSAddress) & 0b00111000;
+}
+
+
+template <class Bus>
+uint8_t AS5600<Bus>::getGain (void)
+{
+  return getRegister (_AGCAddress);
+}
+
+
+template <class Bus>
+uint16_t AS5600<Bus>::getMagnitude (void)
+{
+  return getRegisters2 (_MAGNITUDEAddressMSB);
+}
+
+
+/** This method returns the contents of one register in the AS5600.
+ *  @param reg_addr The register whose contents are to be found
+ *  @return The contents of the register within the AS5600
+ */
+
+template <class Bus>
+uint8_t AS5600<Bus>::getRegister (byte reg_addr)
+{
+	p_i2c->beginTransmission (_AS5600Address);
+	p_i2c->write (reg_addr);
+	p_i2c->endTransmission ();
+
+	uint8_t _byte = 0xFF;
+	p_i2c->requestFrom (_AS5600Address, (uint8_t)1);
+	if (p_i2c->available () <= 1)
+	{
+		_byte = p_i2c->read ();
+	}
+
+	return _byte;
+}
+
+
+/** This method returns the contents of two registers in the AS5600.
+ *  @param registerMSB The register holding the most significant byte of the
+ *  	two-byte number to be received. In the AS5600, the least significant
+ *  	byte will be at the next higher register address
+ *  @return A 16-bit integer containing the contents of the two registers
+ */
+template <class Bus>
+uint16_t AS5600<Bus>::getRegisters2 (uint8_t registerMSB)
+{
+	p_i2c->beginTransmission (_AS5600Address);
+	p_i2c->write (registerMSB);
+	p_i2c->endTransmission ();
+	if (settle_ms)
+	{
+		delay (settle_ms);
+	}
+
+	uint16_t _word = 0xFFFF;
+	p_i2c->requestFrom (_AS5600Address, (uint8_t)2);
+	if (p_i2c->available () >= 2)
+	{
+		_word = p_i2c->read ();
+		_word <<= 8;
+		_word |= p_i2c->read ();
+	}
+
+	return _word;
+}
+
+#endif // _AS5600_H_
@@ -0,0 +1,44 @@
+/** @file angle_average.cpp
+ *  This file contains a class which averages wind directions.
+ */
+
+#include <Arduino.h>
+#include "angle_average.h"
+
+
+/** @brief   Create an empty wind direction average.
+ */
+AngleAverage::AngleAverage (void)
+{
+    clear ();
+}
+
+
+/** @brief   Add one direction to the average.
+ *  @param   degrees The direction in degrees
+ */
+void AngleAverage::add (float degrees)
+{
+    sine_sum += sin (degrees * PI / 180.0);
+    cosine_sum += cos (degrees * PI / 180.0);
+}
+
+
+/** @brief   Find the average of the directions added so far.
+ *  @return  The average direction in degrees, from 0 to 360
+ */
+float AngleAverage::average (void)
+{
+    float avg_angle = atan2 (sine_sum, cosine_sum);
+    avg_angle = (avg_angle > 0.0) ? avg_angle : avg_angle + (2 * PI);
+    return avg_angle * 180.0 / PI;
+}
+
+
+/** @brief   Empty the average so it can start over.
+ */
+void AngleAverage::clear (void)
+{
+    sine_sum = 0.0;
+    cosine_sum = 0.0;
+}
@@ -0,0 +1,27 @@
+/** @file angle_average.h
+ *  This file contains a class which averages wind directions. It's kept apart
+ *  from the vane task so it can also be built and timed on a host computer.
+ */
+
+#ifndef _ANGLE_AVERAGE_H_
+#define _ANGLE_AVERAGE_H_
+
+
+/** @brief   Class which averages wind directions.
+ *  @details Directions are averaged as unit vectors so that readings on both
+ *           sides of north average to north rather than south.
+ */
+class AngleAverage
+{
+protected:
+    float sine_sum;                 ///< Sum of the sines of the angles
+    float cosine_sum;               ///< Sum of the cosines of the angles
+
+public:
+    AngleAverage (void);
+    void add (float degrees);
+    float average (void);
+    void clear (void);
+};
+
+#endif // _ANGLE_AVERAGE_H_
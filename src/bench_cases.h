@@ -0,0 +1,108 @@
+/** @file bench_cases.h
+ *  This file contains the benchmarks which are run both by the station's
+ *  benchmark build, in @c benchmark.cpp, and on a host computer, by
+ *  @c tools/host_tests/host_bench. Each is given the function which times
+ *  code, as the two places time it differently; keeping the cases themselves
+ *  in one place means a benchmark of a given name times the same code in
+ *  both, which @c bench_compare relies on when it matches results by name.
+ */
+
+#ifndef _BENCH_CASES_H_
+#define _BENCH_CASES_H_
+
+#include <Arduino.h>
+#include "taskqueue.h"
+#include "taskshare.h"
+#include "shares.h"
+#include "calibration.h"
+#include "angle_average.h"
+#include "task_vane.h"
+#include "AS5600.h"
+#include "mock_i2c.h"
+
+/// Results are added here so the compiler can't optimize the work away
+extern volatile float bench_sink;
+
+
+/** @brief   Time the vane and anemometer conversions, the vane's averaging and
+ *           reading the vane's sensor through its driver.
+ *  @param   run_bench A function which takes a name, a size, a number of
+ *           iterations and the code to be timed, which takes the iteration
+ */
+template <class Runner>
+void bench_sensors (Runner run_bench)
+{
+    typedef AnemometerCal<SecondWindC3, Mph, 500, 128> FastCal;
+    typedef AnemometerCal<SecondWindC3, Mph, 10000> RecordCal;
+    run_bench ("anemometer_fast", 128, 10000, [] (uint32_t count)
+    {
+        bench_sink = FastCal::convert (count & 127);
+    });
+    run_bench ("anemometer_record", 1024, 10000, [] (uint32_t count)
+    {
+        bench_sink = RecordCal::convert (count & 1023);
+    });
+    run_bench ("vane_convert", 4096, 10000, [] (uint32_t count)
+    {
+        bench_sink = VaneCal<AS5600Vane, Degrees>::convert (count * 7);
+    });
+
+    // The vane task's averaging, one reading per operation as in the task
+    AngleAverage angles;
+    run_bench ("vane_average", VANE_AVERAGE_COUNT, VANE_AVERAGE_COUNT,
+               [&] (uint32_t count)
+    {
+        if (count == 0)
+        {
+            angles.clear ();
+        }
+        angles.add ((count * 37) % 360);
+        if ((count + 1) % 25 == 0)
+        {
+            bench_sink = angles.average ();
+        }
+    });
+
+    // Reading the AS5600 through the driver, with a stand-in bus answering
+    // so the driver's own work is timed rather than the bus or the sensor
+    MockI2C mock_bus (0x36);
+    mock_bus.registers[0x0E] = 0x0A;
+    AS5600 angler (mock_bus, 0x36, 0);
+    run_bench ("as5600_read", 0, 10000, [&] (uint32_t count)
+    {
+        mock_bus.registers[0x0F] = count;
+        bench_sink = angler.getAngle ();
+    });
+}
+
+
+/** @brief   Time handing data from one place to another through the shares,
+ *           queues and sequence locks which the station's tasks use.
+ *  @param   run_bench The timing function, as for @c bench_sensors()
+ */
+template <class Runner>
+void bench_handoff (Runner run_bench)
+{
+    Share<float> bench_share ("Bench Share");
+    run_bench ("share_put_get", 0, 10000, [&] (uint32_t count)
+    {
+        bench_share.put (count);
+        bench_sink = bench_share.get ();
+    });
+    Queue<float> bench_queue (4, "Bench Queue", 0);
+    run_bench ("queue_put_get", 0, 10000, [&] (uint32_t count)
+    {
+        float value;
+        bench_queue.put (count);
+        bench_queue.get (value);
+        bench_sink = value;
+    });
+    SeqLock<Conditions> bench_lock;
+    run_bench ("seqlock_update_get", 0, 10000, [&] (uint32_t count)
+    {
+        bench_lock.update ([count] (Conditions& now) { now.time = count; });
+        bench_sink = bench_lock.get ().time;
+    });
+}
+
+#endif // _BENCH_CASES_H_
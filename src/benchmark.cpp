@@ -0,0 +1,212 @@
+/** @file benchmark.cpp
+ *  This file contains a task which times the station's processing hot paths
+ *  and prints the results as JSON, one line per benchmark, such as
+ *      {"bench":"plot_to_json","size":100,"iters":20,"ns_per_op":1234.5,...}
+ *  Each benchmark is repeated until one run takes at least a millisecond, and
+ *  that run is timed several times over; @c ns_per_op is the best run,
+ *  which is the figure least disturbed by other tasks and interrupts, and
+ *  @c mean_ns is the average over all the runs. Results from two builds can
+ *  be compared with the host program in @c tools/bench_compare.
+ *
+ *  This file is only compiled when @c BENCHMARK is defined, as it is in the
+ *  @c benchmark environment in @c platformio.ini.
+ */
+
+#ifdef BENCHMARK
+
+#include <Arduino.h>
+#include "PrintStream.h"
+#include "taskqueue.h"
+#include "node_red_plot.h"
+#include "publisher.h"
+#include "bench_cases.h"
+#include "benchmark.h"
+
+
+const uint8_t Repeats = 5;              ///< Times each benchmark is run
+const uint32_t MinRunTime = 1000;       ///< Shortest timed run in microseconds
+
+/// Results are added here so the compiler can't optimize the work away
+volatile float bench_sink;
+
+/// Queues which carry values to a partner task and back again
+Queue<uint32_t> ping_queue (1, "Ping", portMAX_DELAY);
+Queue<uint32_t> pong_queue (1, "Pong", portMAX_DELAY);
+
+
+/** @brief   Time some number of passes over a benchmark's iterations.
+ *  @return  The time taken in microseconds
+ */
+template <class Code>
+uint32_t time_passes (uint32_t iterations, uint32_t passes, Code& code)
+{
+    uint32_t start = micros ();
+    for (uint32_t pass = 0; pass < passes; pass++)
+    {
+        for (uint32_t count = 0; count < iterations; count++)
+        {
+            code (count);
+        }
+    }
+    return micros () - start;
+}
+
+
+/** @brief   Run some code many times and print how long it took.
+ *  @details One pass runs the code with each iteration number in turn. The
+ *           number of passes in a timed run is doubled until a run takes at
+ *           least @c MinRunTime, so that the microsecond clock's resolution
+ *           is a small part of each result, and then @c Repeats runs are
+ *           timed. The number of operations printed is for one timed run.
+ *  @param   name The name of the benchmark
+ *  @param   size The size of the data being worked on, or 0 if there isn't one
+ *  @param   iterations The number of iterations in one pass
+ *  @param   code A function object which takes the iteration number
+ */
+template <class Code>
+void run_bench (const char* name, uint32_t size, uint32_t iterations,
+                Code code)
+{
+    uint32_t passes = 1;
+    while (time_passes (iterations, passes, code) < MinRunTime
+           && passes < (1UL << 24) / iterations)
+    {
+        passes *= 2;
+        vTaskDelay (1);                 // Let the idle task feed the watchdog
+    }
+
+    uint32_t best = UINT32_MAX;
+    uint32_t total = 0;
+    for (uint8_t repeat = 0; repeat < Repeats; repeat++)
+    {
+        vTaskDelay (1);
+        uint32_t elapsed = time_passes (iterations, passes, code);
+        best = min (best, elapsed);
+        total += elapsed;
+    }
+
+    uint32_t operations = iterations * passes;
+    Serial.printf ("{\"bench\":\"%s\",\"size\":%lu,\"iters\":%lu,"
+                   "\"ns_per_op\":%.3f,\"mean_ns\":%.3f}\n", name,
+                   (unsigned long)size, (unsigned long)operations,
+                   best * 1000.0 / operations,
+                   total * 1000.0 / operations / Repeats);
+}
+
+
+/** @brief   Sink which throws messages away, so publishing can be timed
+ *           without any real destination getting in the way.
+ */
+class NullSink : public PublishSink
+{
+protected:
+    bool deliver (const Payload& payload)
+    {
+        bench_sink = payload.length;
+        return true;
+    }
+
+public:
+    NullSink (void) : PublishSink (16, DROP_OLDEST, 0, portMAX_DELAY) { }
+};
+
+
+/** @brief   Task which sends back whatever comes in the ping queue.
+ */
+void pong_task (void* p_params)
+{
+    uint32_t value;
+
+    for (;;)
+    {
+        ping_queue.get (value);
+        pong_queue.put (value);
+    }
+}
+
+
+/** @brief   Time adding points to a Node-RED plot and making its message.
+ *  @details @c mqtt_send() is @c to_json() plus a copy and the broker's own
+ *           time, so the message making is timed here without a network.
+ */
+template <uint16_t points>
+void bench_plot (void)
+{
+    static const char* labels[] = {"Sine", "Cosine"};
+    static NodeRedPlot<2, points> plot ("bench/plot", labels);
+    float y_data[2] = {0.5, -0.5};
+
+    run_bench ("plot_add_data", points, points, [&] (uint32_t count)
+    {
+        if (count == 0)
+        {
+            plot.clear ();
+        }
+        plot.add_data (count, y_data);
+    });
+
+    uint32_t iterations = points < 100 ? 100 : 10;
+    run_bench ("plot_to_json", points, iterations, [&] (uint32_t count)
+    {
+        bench_sink = plot.to_json ().length ();
+    });
+}
+
+
+/** @brief   Task which runs all the benchmarks once, then sits around.
+ */
+void benchmark_task (void* p_params)
+{
+    Serial.printf ("{\"suite\":\"ESP32wind\",\"cpu_mhz\":%lu,"
+                   "\"free_heap\":%lu}\n", (unsigned long)getCpuFrequencyMhz (),
+                   (unsigned long)ESP.getFreeHeap ());
+
+    // Node-RED plots of several sizes
+    bench_plot<10> ();
+    bench_plot<100> ();
+    bench_plot<500> ();
+
+    // The conversions, averaging and hand-offs which the host runs too
+    auto runner = [] (const char* name, uint32_t size, uint32_t iterations,
+                      auto code)
+    {
+        run_bench (name, size, iterations, code);
+    };
+    bench_sensors (runner);
+    bench_handoff (runner);
+
+    // A round trip to a task on the other core and back; this task runs on
+    // core 1, as the Arduino loop does
+    xTaskCreatePinnedToCore (pong_task, "Pong", 2048, NULL, 2, NULL, 0);
+    run_bench ("queue_round_trip", 0, 1000, [] (uint32_t count)
+    {
+        uint32_t value;
+        ping_queue.put (count);
+        pong_queue.get (value);
+    });
+
+    // Publishing a message to several sinks, each emptied by its own task
+    Publisher bench_publisher;
+    NullSink sinks[3];
+    for (uint8_t index = 0; index < 3; index++)
+    {
+        bench_publisher.add_sink (sinks[index]);
+        xTaskCreate (PublishSink::task, "Null Sink", 2048, &sinks[index], 2,
+                     NULL);
+    }
+    char message[201];
+    memset (message, 'x', 200);
+    message[200] = '\0';
+    run_bench ("publish_fanout", 3, 1000, [&] (uint32_t count)
+    {
+        bench_publisher.publish ("bench/publish", message);
+    });
+
+    Serial.printf ("{\"done\":true}\n");
+    for (;;)
+    {
+        vTaskDelay (10000);
+    }
+}
+
+#endif // BENCHMARK
@@ -0,0 +1,8 @@
+/** @file benchmark.h
+ *  This file contains a task which times the station's processing hot paths
+ *  and prints the results as JSON, one line per benchmark. It's only built
+ *  into the @c benchmark environment in @c platformio.ini, which runs it
+ *  instead of the weather station tasks.
+ */
+
+void benchmark_task (void* p_params);
@@ -0,0 +1,246 @@
+/** @file calibration.h
+ *  This file contains calibration tables which convert raw sensor counts into
+ *  wind speeds and directions. The tables are built by the compiler from each
+ *  sensor model's calibration data, so converting a reading at run time is
+ *  just a table lookup with no branches.
+ */
+
+#ifndef _CALIBRATION_H_
+#define _CALIBRATION_H_
+
+#include <stdint.h>
+
+
+/// Wind speed in meters per second, the units in which sensors are calibrated
+struct MetersPerSec
+{
+    static constexpr double per_mps = 1.0;
+};
+
+/// Wind speed in miles per hour
+struct Mph
+{
+    static constexpr double per_mps = 2.2369363;
+};
+
+/// Wind speed in knots
+struct Knots
+{
+    static constexpr double per_mps = 1.9438445;
+};
+
+/// Angles in degrees, the units in which vanes are calibrated
+struct Degrees
+{
+    static constexpr double per_degree = 1.0;
+};
+
+/// Angles in radians
+struct Radians
+{
+    static constexpr double per_degree = 3.14159265358979 / 180.0;
+};
+
+
+/** @brief   Calibration of a Second Wind C3 anemometer with a Hall sensor.
+ *  @details A Hall effect sensor placed in the anemometer makes two pulses
+ *           per revolution. The fit is m/s = Hz * 0.766 + 0.324, where Hz is
+ *           pulses per second; that's mph = Hz * 1.714 + 0.725. Coefficients
+ *           are listed from the constant term up.
+ */
+struct SecondWindC3
+{
+    static constexpr double poly[] = {0.324, 0.766};
+    static constexpr uint8_t poly_order = 1;
+};
+
+
+/** @brief   Calibration of a wind vane turning an AS5600 magnetic encoder.
+ *  @details The encoder gives 4096 counts per turn. @c offset is the angle
+ *           (in degrees) read when the vane points north. @c error holds the
+ *           encoder's nonlinearity measured at each 1/16 turn, in degrees by
+ *           which the reading is too high, with the last point being a whole
+ *           turn; readings in between are corrected by linear interpolation.
+ */
+struct AS5600Vane
+{
+    static constexpr uint16_t counts_per_turn = 4096;
+    static constexpr double offset = 0.0;
+    static constexpr double error[17] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                                         0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                                         0.0, 0.0, 0.0};
+};
+
+
+/// A table of converted values, one for each possible count
+template <uint16_t size>
+struct CountTable
+{
+    float value[size];
+};
+
+
+/// A table of straight line segments, one for each 1/16 of the count range
+struct SegmentTable
+{
+    float base[16];             ///< Converted value at the start of a segment
+    float slope[16];            ///< Change in value per count in the segment
+};
+
+
+/** @brief   Find the base 2 logarithm of a power of two at compile time.
+ */
+constexpr uint8_t log2_of (uint16_t number)
+{
+    uint8_t power = 0;
+    while (number >>= 1)
+    {
+        power++;
+    }
+    return power;
+}
+
+
+/** @brief   Build an anemometer table from a sensor's calibration polynomial.
+ *  @details No pulses at all means a calm, so count 0 maps to zero rather
+ *           than to the polynomial's constant term.
+ */
+template <class Sensor, class Units, uint32_t window_ms, uint16_t size>
+constexpr CountTable<size> make_anemometer_table (void)
+{
+    CountTable<size> table {};
+    for (uint16_t counts = 1; counts < size; counts++)
+    {
+        double hertz = counts * 1000.0 / window_ms;
+        double mps = 0.0;
+        for (int8_t power = Sensor::poly_order; power >= 0; power--)
+        {
+            mps = mps * hertz + Sensor::poly[power];
+        }
+        table.value[counts] = (float)(mps * Units::per_mps);
+    }
+    return table;
+}
+
+
+/** @brief   Build a vane table from a sensor's offset and nonlinearity.
+ */
+template <class Sensor, class Units>
+constexpr SegmentTable make_vane_table (void)
+{
+    SegmentTable table {};
+    const double per_segment = 360.0 / 16;
+    for (uint8_t segment = 0; segment < 16; segment++)
+    {
+        double start = segment * per_segment - Sensor::error[segment]
+                       - Sensor::offset;
+        double finish = (segment + 1) * per_segment
+                        - Sensor::error[segment + 1] - Sensor::offset;
+        table.base[segment] = (float)(start * Units::per_degree);
+        table.slope[segment] = (float)((finish - start) * Units::per_degree
+                                * 16 / Sensor::counts_per_turn);
+    }
+    return table;
+}
+
+
+/** @brief   Class which converts anemometer pulse counts to wind speed.
+ *  @details The table is built at compile time for one sensor model, one set
+ *           of units and one counting window, and holds a speed for each
+ *           possible count. Counts beyond the table give the table's last
+ *           value.
+ *  @tparam  Sensor The sensor's calibration, such as @c SecondWindC3
+ *  @tparam  Units The units of the result, such as @c Mph
+ *  @tparam  window_ms The time over which pulses are counted, in milliseconds
+ *  @tparam  size The number of counts in the table
+ */
+template <class Sensor, class Units, uint32_t window_ms, uint16_t size = 1024>
+class AnemometerCal
+{
+protected:
+    static constexpr CountTable<size> table
+        = make_anemometer_table<Sensor, Units, window_ms, size> ();
+
+public:
+    /** @brief   Convert a pulse count to a wind speed.
+     *  @param   counts The number of pulses counted in the window
+     */
+    static float convert (uint16_t counts)
+    {
+        return table.value[counts < size ? counts : size - 1];
+    }
+
+    /** @brief   Look up the speed in the table at compile time.
+     */
+    static constexpr float at (uint16_t counts)
+    {
+        return table.value[counts];
+    }
+};
+
+
+/** @brief   Class which converts wind vane encoder counts to a direction.
+ *  @details The count range is split into 16 segments, each converted by a
+ *           straight line whose ends come from the sensor's calibration, and
+ *           the result is wrapped into one turn. The segment and the fraction
+ *           of it are found by shifting and masking the count.
+ *  @tparam  Sensor The sensor's calibration, such as @c AS5600Vane
+ *  @tparam  Units The units of the result, such as @c Degrees
+ */
+template <class Sensor, class Units>
+class VaneCal
+{
+protected:
+    static_assert (Sensor::counts_per_turn % 16 == 0
+                   && (Sensor::counts_per_turn
+                       & (Sensor::counts_per_turn - 1)) == 0,
+                   "Vane counts per turn must be a power of two");
+
+    static constexpr uint16_t segment_counts = Sensor::counts_per_turn / 16;
+    static constexpr uint8_t shift = log2_of (segment_counts);
+    static constexpr SegmentTable table = make_vane_table<Sensor, Units> ();
+    static constexpr float turn = (float)(360.0 * Units::per_degree);
+
+public:
+    /** @brief   Convert an encoder count to a direction.
+     *  @param   counts The reading from the encoder
+     */
+    static float convert (uint16_t counts)
+    {
+        counts &= Sensor::counts_per_turn - 1;
+        uint8_t segment = counts >> shift;
+        uint16_t fraction = counts & (segment_counts - 1);
+        float angle = table.base[segment] + table.slope[segment] * fraction;
+        angle -= turn * (angle >= turn);
+        angle += turn * (angle < 0.0f);
+        return angle;
+    }
+
+    /** @brief   Look up the direction at the start of a segment at compile
+     *           time, before wrapping into one turn.
+     */
+    static constexpr float segment_start (uint8_t segment)
+    {
+        return table.base[segment];
+    }
+};
+
+
+// Check the tables against the reference calibration: 1 Hz from the C3 is
+// 1.090 m/s or 2.439 mph, and 10 Hz is 7.984 m/s or 17.86 mph
+static_assert (AnemometerCal<SecondWindC3, MetersPerSec, 10000>::at (10)
+               > 1.089f && AnemometerCal<SecondWindC3, MetersPerSec, 10000>
+               ::at (10) < 1.091f, "C3 table wrong at 1 Hz, m/s");
+static_assert (AnemometerCal<SecondWindC3, Mph, 10000>::at (10) > 2.43f
+               && AnemometerCal<SecondWindC3, Mph, 10000>::at (10) < 2.45f,
+               "C3 table wrong at 1 Hz, mph");
+static_assert (AnemometerCal<SecondWindC3, Mph, 500>::at (5) > 17.85f
+               && AnemometerCal<SecondWindC3, Mph, 500>::at (5) < 17.87f,
+               "C3 table wrong at 10 Hz in a half second window, mph");
+static_assert (AnemometerCal<SecondWindC3, Mph, 500>::at (0) == 0.0f,
+               "C3 table should read zero when there are no pulses");
+static_assert (VaneCal<AS5600Vane, Degrees>::segment_start (4) > 89.99f
+               && VaneCal<AS5600Vane, Degrees>::segment_start (4) < 90.01f,
+               "Vane table wrong at a quarter turn");
+
+#endif // _CALIBRATION_H_
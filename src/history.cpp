@@ -0,0 +1,182 @@
+/** @file history.cpp
+ *  This file contains a class which keeps a ring buffer of recent weather
+ *  conditions so that they can be looked up by time, and a function which
+ *  sends them out as CSV a piece at a time.
+ */
+
+#include <Arduino.h>
+#include "history.h"
+
+
+/** @brief   Create an empty history with room for a given number of records.
+ *  @param   max_records The number of records which will be kept
+ */
+History::History (uint16_t max_records)
+{
+    size = max_records;
+    records = new Conditions[size];
+    count = 0;
+}
+
+
+/** @brief   Add a record, writing over the oldest one if the history is full.
+ *  @param   record The record to be added
+ */
+void History::add (const Conditions& record)
+{
+    records[count % size] = record;
+    count++;
+}
+
+
+/** @brief   Get the sequence number of the oldest record still kept.
+ */
+uint32_t History::first (void)
+{
+    return count > size ? count - size : 0;
+}
+
+
+/** @brief   Get the sequence number which the next record added will have.
+ */
+uint32_t History::end (void)
+{
+    return count;
+}
+
+
+/** @brief   Get the record with the given sequence number.
+ *  @details The sequence number must be between @c first() and @c end().
+ *  @param   sequence The sequence number of the record
+ */
+const Conditions& History::at (uint32_t sequence)
+{
+    return records[sequence % size];
+}
+
+
+/** @brief   Find the first record made later than the given time.
+ *  @details Times are compared by how long before the newest record they
+ *           are, so the search still works after @c millis() wraps around
+ *           at 49.7 days, as long as the history covers less time than that.
+ *           A time later than the newest record, which a client can only
+ *           have if it got it before the station restarted, is taken to be
+ *           from long ago, so that client gets every record kept.
+ *  @param   since A time in milliseconds since boot
+ *  @return  The sequence number of the first record with a later time, or
+ *           @c end() if there isn't one
+ */
+uint32_t History::find_after (uint32_t since)
+{
+    uint32_t low = first ();
+    uint32_t high = end ();
+    if (low == high)
+    {
+        return low;
+    }
+
+    uint32_t newest = at (high - 1).time;
+    uint32_t since_age = newest - since;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        if (newest - at (middle).time < since_age)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+
+/// Names of the channels, in the order used by @c channel_value()
+const char* const history_channels[HISTORY_CHANNELS] = {"wind_speed",
+    "wind_dir", "gust", "temperature", "humidity"};
+
+
+/** @brief   Get the value of one channel from a conditions record.
+ *  @param   record The record
+ *  @param   channel 0 to 4 for wind speed, wind direction, gust, temperature
+ *           and humidity
+ */
+float channel_value (const Conditions& record, uint8_t channel)
+{
+    switch (channel)
+    {
+        case 0: return record.wind_speed;
+        case 1: return record.wind_dir;
+        case 2: return record.gust;
+        case 3: return record.temperature;
+        default: return record.humidity;
+    }
+}
+
+
+/** @brief   Fill a buffer with one HTTP chunk of @c time,value CSV rows.
+ *  @details Rows are formatted straight from the history records for as long
+ *           as another whole row fits, so a long response never needs a
+ *           buffer any bigger than a chunk. Room is left in front of the rows
+ *           for the chunk size line, which is then written right up against
+ *           them so the whole chunk can be sent at once. Records which were
+ *           written over since the last chunk are skipped. The buffer should
+ *           hold at least @c HISTORY_ROW_MAX bytes more than the chunk
+ *           framing; a row which still doesn't fit in an empty chunk is
+ *           skipped so that the response can't get stuck on it.
+ *  @param   history The history being sent
+ *  @param   channel The channel being sent, as for @c channel_value()
+ *  @param   next The sequence number of the next record to be sent, which is
+ *           moved past the records put into this chunk
+ *  @param   end Stop sending at this sequence number
+ *  @param   buffer The buffer in which the chunk is made
+ *  @param   size The size of @c buffer
+ *  @param   p_start Set to where the chunk begins in @c buffer
+ *  @return  The number of bytes in the chunk, or 0 if there were no rows
+ */
+size_t make_chunk (History& history, uint8_t channel, uint32_t& next,
+                   uint32_t end, char* buffer, size_t size,
+                   const char** p_start)
+{
+    const uint8_t header = 6;               // Room for "xxxx\r\n" in front
+    const uint8_t trailer = 2;              // Room for "\r\n" at the end
+    size_t length = header;
+
+    if (next < history.first ())
+    {
+        next = history.first ();
+    }
+    while (next < end && length + trailer < size)
+    {
+        const Conditions& record = history.at (next);
+        size_t room = size - length - trailer;
+        int row = snprintf (buffer + length, room, "%lu,%.2f\n",
+                            (unsigned long)record.time,
+                            channel_value (record, channel));
+        if (row > 0 && (size_t)row < room)
+        {
+            length += row;
+        }
+        else if (length > header)
+        {
+            break;                          // Send it in the next chunk
+        }
+        next++;
+    }
+
+    if (length == header)
+    {
+        return 0;
+    }
+
+    // Put the chunk size right in front of the data
+    char size_line[header + 1];
+    uint8_t size_length = snprintf (size_line, sizeof (size_line), "%x\r\n",
+                                    (unsigned)(length - header));
+    *p_start = buffer + header - size_length;
+    memcpy (buffer + header - size_length, size_line, size_length);
+    memcpy (buffer + length, "\r\n", trailer);
+    return length + trailer - header + size_length;
+}
@@ -0,0 +1,53 @@
+/** @file history.h
+ *  This file contains a class which keeps a ring buffer of recent weather
+ *  conditions so that they can be looked up by time, and a function which
+ *  sends them out as CSV a piece at a time.
+ */
+
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include <Arduino.h>
+#include "shares.h"
+
+
+/// The most room one CSV row of history can take, such as a full 32 bit time
+/// and the biggest float printed with two decimals
+const uint8_t HISTORY_ROW_MAX = 64;
+
+/// Number of channels which can be taken from a record
+const uint8_t HISTORY_CHANNELS = 5;
+
+
+/** @brief   Class which holds the most recent records of weather conditions.
+ *  @details Each record added gets a sequence number one higher than the last.
+ *           Only the latest @c size records are kept, so the valid sequence
+ *           numbers run from @c first() up to but not including @c end().
+ *           Sequence numbers let a reader which is working through the
+ *           history a piece at a time notice when records it hasn't reached
+ *           yet have been written over.
+ */
+class History
+{
+protected:
+    Conditions* records;             ///< Storage for the records
+    uint16_t size;                   ///< Number of records which can be kept
+    uint32_t count;                  ///< Number of records ever added
+
+public:
+    History (uint16_t max_records);
+    void add (const Conditions& record);
+    uint32_t first (void);
+    uint32_t end (void);
+    const Conditions& at (uint32_t sequence);
+    uint32_t find_after (uint32_t since);
+};
+
+extern const char* const history_channels[HISTORY_CHANNELS];
+
+float channel_value (const Conditions& record, uint8_t channel);
+size_t make_chunk (History& history, uint8_t channel, uint32_t& next,
+                   uint32_t end, char* buffer, size_t size,
+                   const char** p_start);
+
+#endif // _HISTORY_H_
@@ -0,0 +1,145 @@
+/** @file http_history.cpp
+ *  This file contains the functions which parse requests for history. They
+ *  don't depend on the type of connection, so they're not templates.
+ */
+
+#include <Arduino.h>
+#include "http_history.h"
+
+
+/** @brief   Find where a parameter's value begins in a URL query string.
+ *  @param   query The query string, such as @c "a=1&b=2"
+ *  @param   key The name of the parameter to be found
+ *  @return  A pointer to the value, or @c NULL if the parameter isn't there
+ */
+const char* find_param (const char* query, const char* key)
+{
+    size_t key_length = strlen (key);
+    for (const char* p_field = query; p_field; )
+    {
+        if (strncmp (p_field, key, key_length) == 0
+            && p_field[key_length] == '=')
+        {
+            return p_field + key_length + 1;
+        }
+        p_field = strchr (p_field, '&');
+        p_field = p_field ? p_field + 1 : NULL;
+    }
+    return NULL;
+}
+
+
+/** @brief   Find the value of a parameter in a URL query string.
+ *  @param   query The query string, such as @c "a=1&b=2"
+ *  @param   key The name of the parameter to be found
+ *  @param   value A buffer into which the value is copied
+ *  @param   size The size of @c value
+ *  @return  True if the parameter was found and its value fits in @c value
+ */
+bool query_value (const char* query, const char* key, char* value, size_t size)
+{
+    const char* p_value = find_param (query, key);
+    if (!p_value)
+    {
+        return false;
+    }
+    size_t length = strcspn (p_value, "&");
+    if (length >= size)
+    {
+        return false;
+    }
+    memcpy (value, p_value, length);
+    value[length] = '\0';
+    return true;
+}
+
+
+/** @brief   Parse the request line of a request for history.
+ *  @details The request line is cut off after its target, so headers can't
+ *           be mistaken for query parameters. The target must be
+ *           @c /history, with or without a query; the @c channel is needed,
+ *           @c res may be @c 1m or @c 10m, and @c since is optional but must
+ *           be a number which fits in 32 bits if it's there.
+ *  @param   request The request, which ends with a null and is changed
+ *  @param   query Filled in with what the request asked for
+ *  @return  200 if the request is good, 404 if it's for something else, or
+ *           400 if its query isn't right
+ */
+uint16_t parse_history_request (char* request, HistoryQuery& query)
+{
+    const char* prefix = "GET /history";
+    char* p_end = strchr (request, '\r');
+    if (p_end)
+    {
+        *p_end = '\0';
+    }
+    p_end = strchr (request, ' ');
+    p_end = p_end ? strchr (p_end + 1, ' ') : NULL;
+    if (p_end)
+    {
+        *p_end = '\0';
+    }
+
+    if (strncmp (request, prefix, strlen (prefix)) != 0)
+    {
+        return 404;
+    }
+    const char* p_query = request + strlen (prefix);
+    if (*p_query != '?' && *p_query != '\0')
+    {
+        return 404;
+    }
+    p_query = (*p_query == '?') ? p_query + 1 : "";
+
+    char value[16];
+    query.channel = HISTORY_CHANNELS;
+    if (query_value (p_query, "channel", value, sizeof (value)))
+    {
+        for (uint8_t index = 0; index < HISTORY_CHANNELS; index++)
+        {
+            if (strcmp (value, history_channels[index]) == 0)
+            {
+                query.channel = index;
+            }
+        }
+    }
+    if (query.channel >= HISTORY_CHANNELS)
+    {
+        return 400;
+    }
+
+    query.slow = false;
+    if (find_param (p_query, "res"))
+    {
+        if (!query_value (p_query, "res", value, sizeof (value)))
+        {
+            return 400;
+        }
+        if (strcmp (value, "10m") == 0)
+        {
+            query.slow = true;
+        }
+        else if (strcmp (value, "1m") != 0)
+        {
+            return 400;
+        }
+    }
+
+    query.has_since = find_param (p_query, "since") != NULL;
+    if (query.has_since)
+    {
+        char* p_digits_end;
+        if (!query_value (p_query, "since", value, sizeof (value)))
+        {
+            return 400;
+        }
+        unsigned long long since = strtoull (value, &p_digits_end, 10);
+        if (p_digits_end == value || *p_digits_end != '\0'
+            || !isdigit (value[0]) || since > UINT32_MAX)
+        {
+            return 400;
+        }
+        query.since = since;
+    }
+    return 200;
+}
@@ -0,0 +1,196 @@
+/** @file http_history.h
+ *  This file contains the part of the history server which looks after one
+ *  HTTP client: reading its request, parsing it, and sending the response a
+ *  chunk at a time. The type of the client's connection is a template
+ *  parameter; on the station it's a @c WiFiClient, and on a host computer a
+ *  stand-in connection lets the server be tested with many clients at once.
+ */
+
+#ifndef _HTTP_HISTORY_H_
+#define _HTTP_HISTORY_H_
+
+#include <Arduino.h>
+#include "history.h"
+
+
+const uint8_t HTTP_REQUEST_MAX = 160;       ///< Room for the request line
+const uint32_t HTTP_REQUEST_TIMEOUT = 5000; ///< Time to send a request (ms)
+const uint16_t HTTP_CHUNK_SIZE = 20 * 24 + HISTORY_ROW_MAX;  ///< Chunk buffer
+
+
+/** @brief   What a request for history asked for.
+ */
+struct HistoryQuery
+{
+    uint8_t channel;                    ///< Index of the channel wanted
+    bool slow;                          ///< True for the 10 minute records
+    bool has_since;                     ///< True if @c since was given
+    uint32_t since;                     ///< Send only records after this
+};
+
+
+const char* find_param (const char* query, const char* key);
+bool query_value (const char* query, const char* key, char* value,
+                  size_t size);
+uint16_t parse_history_request (char* request, HistoryQuery& query);
+
+
+/** @brief   The state of one client connection.
+ *  @tparam  Client The type of the connection, such as @c WiFiClient
+ */
+template <class Client>
+struct HttpSlot
+{
+    Client client;                      ///< The connection
+    bool active;                        ///< True if this slot is in use
+    bool streaming;                     ///< True once the request is parsed
+    char request[HTTP_REQUEST_MAX];     ///< The request as it comes in
+    uint8_t length;                     ///< Number of bytes in @c request
+    uint32_t start_time;                ///< When the client connected
+    History* p_history;                 ///< The history being sent
+    uint8_t channel;                    ///< Index of the channel being sent
+    uint32_t next;                      ///< Next record to be sent
+    uint32_t end;                       ///< Stop sending at this record
+
+    /** @brief   Start looking after a new connection.
+     */
+    void open (const Client& new_client, uint32_t now)
+    {
+        client = new_client;
+        active = true;
+        streaming = false;
+        length = 0;
+        start_time = now;
+    }
+
+    /** @brief   Drop the connection and free the slot.
+     */
+    void close (void)
+    {
+        client.stop ();
+        active = false;
+    }
+};
+
+
+/** @brief   Send a short complete response and close the connection.
+ */
+template <class Client>
+void send_error (HttpSlot<Client>& slot, const char* status)
+{
+    slot.client.printf ("HTTP/1.1 %s\r\nContent-Type: text/plain\r\n"
+                        "Content-Length: %u\r\nConnection: close\r\n\r\n%s\n",
+                        status, (unsigned)strlen (status) + 1, status);
+    slot.close ();
+}
+
+
+/** @brief   Parse a complete request and start the response to it.
+ *  @param   slot The client's slot, holding the request
+ *  @param   fast The history of 1 minute records
+ *  @param   slow The history of 10 minute records
+ *  @param   now The time since boot in milliseconds, sent to the client
+ */
+template <class Client>
+void start_response (HttpSlot<Client>& slot, History& fast, History& slow,
+                     uint32_t now)
+{
+    HistoryQuery query;
+    switch (parse_history_request (slot.request, query))
+    {
+        case 200: break;
+        case 404: send_error (slot, "404 Not Found"); return;
+        default: send_error (slot, "400 Bad Request"); return;
+    }
+
+    // Send only records after the given time, and only those which are
+    // already here; anything newer goes to the next poll
+    slot.p_history = query.slow ? &slow : &fast;
+    slot.channel = query.channel;
+    slot.next = query.has_since ? slot.p_history->find_after (query.since)
+                                : slot.p_history->first ();
+    slot.end = slot.p_history->end ();
+
+    char header[128];
+    size_t length = snprintf (header, sizeof (header), "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: text/csv\r\nTransfer-Encoding: "
+                              "chunked\r\nX-Uptime-Ms: %lu\r\nConnection: "
+                              "close\r\n\r\n", (unsigned long)now);
+    if (slot.client.write ((const uint8_t*)header, length) != length)
+    {
+        slot.close ();
+        return;
+    }
+    slot.streaming = true;
+}
+
+
+/** @brief   Send the next chunk of a response, finishing it if it's done.
+ *  @details Other clients get their turns between chunks. If the connection
+ *           takes only part of a chunk, the client is dropped, because the
+ *           bytes sent would no longer match the chunk's size and anything
+ *           sent after them would be garbage to the client.
+ */
+template <class Client>
+void send_chunk (HttpSlot<Client>& slot)
+{
+    char chunk[HTTP_CHUNK_SIZE];
+    const char* p_start;
+    size_t length = make_chunk (*slot.p_history, slot.channel, slot.next,
+                                slot.end, chunk, sizeof (chunk), &p_start);
+    if (length && slot.client.write ((const uint8_t*)p_start, length)
+                  != length)
+    {
+        slot.close ();
+        return;
+    }
+
+    if (slot.next >= slot.end || !slot.client.connected ())
+    {
+        slot.client.print ("0\r\n\r\n");
+        slot.close ();
+    }
+}
+
+
+/** @brief   Give one client its turn: read its request, or send it a chunk.
+ *  @details The request line is all that's needed; headers are ignored. A
+ *           client whose request line doesn't fit is told so, and one which
+ *           takes too long to send it or goes away is dropped.
+ *  @param   slot The client's slot, which must be active
+ *  @param   fast The history of 1 minute records
+ *  @param   slow The history of 10 minute records
+ *  @param   now The time since boot in milliseconds
+ */
+template <class Client>
+void serve_slot (HttpSlot<Client>& slot, History& fast, History& slow,
+                 uint32_t now)
+{
+    if (slot.streaming)
+    {
+        send_chunk (slot);
+        return;
+    }
+
+    while (slot.client.available () && slot.length < sizeof (slot.request) - 1)
+    {
+        slot.request[slot.length++] = slot.client.read ();
+    }
+    slot.request[slot.length] = '\0';
+
+    if (strstr (slot.request, "\r\n"))
+    {
+        start_response (slot, fast, slow, now);
+    }
+    else if (slot.length >= sizeof (slot.request) - 1)
+    {
+        send_error (slot, "414 URI Too Long");
+    }
+    else if (now - slot.start_time > HTTP_REQUEST_TIMEOUT
+             || !slot.client.connected ())
+    {
+        slot.close ();
+    }
+}
+
+#endif // _HTTP_HISTORY_H_
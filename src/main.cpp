@@ -8,11 +8,18 @@
 #include <dht11.h>
 #include <PubSubClient.h>
 
-// #include "taskqueue.h"
+#include "taskqueue.h"
 #include "taskshare.h"
+#include "shares.h"
 #include "task_anemometer.h"
 #include "task_vane.h"
 #include "task_mqtt.h"
+#include "task_turbulence.h"
+#include "task_http.h"
+#include "task_nethealth.h"
+#include "publisher.h"
+#include "publish_sinks.h"
+#include "benchmark.h"
 
 // #include "ESP32Time.h"
 
@@ -21,43 +28,36 @@
 const uint8_t DHT11_PIN = 32;
 
 
-/// A share for the measured wind speed in mph, declared extern in shares.h
-Share<float> wind_speed ("Wind Speed");
+/// The current averaged weather conditions, declared extern in shares.h
+SeqLock<Conditions> conditions;
 
-/// A share for the average wind direction during a certain period
-Share<float> wind_dir ("Wind Dir");
+/// Moving averages describing the network link, declared extern in shares.h
+SeqLock<NetHealth> net_health;
+
+/// The publisher which sends messages to every sink, declared in publisher.h
+Publisher publisher;
+
+/// A sink which shows everything published on the serial console
+SerialSink serial_sink (Serial, 16, DROP_NEWEST);
+
+/// A share for the most recent, unaveraged wind vane angle
+Share<float> vane_angle ("Vane Angle");
+
+/// A queue of sub-second wind speeds in mph for turbulence measurements
+Queue<float> speed_samples (8, "Speed Samples", 0);
+
+/// A queue which carries turbulence reports to the MQTT task for publishing
+Queue<TurbulenceReport> turbulence_reports (2, "Turbulence", 0);
 
 
 /** @brief   Task which shows useful debugging stuff on a serial port.
+ *  @details Everything that's published comes through the serial sink's queue
+ *           and is printed here, so a slow serial port never holds up the
+ *           tasks which publish.
  */
 void serial_task (void* p_params)
 {
-    // uint32_t time = 0;
-    const TickType_t delay = 5000;
-    String stringy;
-
-    for (;;)
-    {
-        // for (uint16_t count = 0; count < ARRAY_SIZE; count++)
-        // {
-        //     float sineful = sin((float)count / 7);
-        //     float cosful = cos((float)count / 7);
-        //     times[count] = count;
-        //     sines[count] = sineful;
-        //     cosines[count] = cosful;
-
-        //     float blah[2];
-        //     blah[0] = sineful;
-        //     blah[1] = cosful;
-        //     plotzy.add_data(count, blah);
-        //     plotzy.print_data(Serial);
-
-        //     vTaskDelay(delay);
-        // }
-        // plotzy.clear();
-        Serial << "Wind Speed: " << wind_speed.get () << " mph" << endl;
-        vTaskDelay (60000);
-    }
+    serial_sink.run ();
 }
 
 
@@ -75,6 +75,16 @@ void temp_humid_task (void* p_params)
                << "%, Temperature: " << (float)sensor.temperature << "C" 
                << endl;
 
+        if (chk == DHTLIB_OK)
+        {
+            conditions.update ([&sensor] (Conditions& now)
+            {
+                now.temperature = sensor.temperature;
+                now.humidity = sensor.humidity;
+                now.time = millis ();
+            });
+        }
+
         vTaskDelay (60000);
     }
 }
@@ -91,16 +101,31 @@ void setup ()
     Serial << "Test of Anemometer" << endl;
     vTaskDelay (5000);
 
+#ifdef BENCHMARK
+    // A benchmark build only times things; the station itself doesn't run
+    xTaskCreatePinnedToCore (benchmark_task, "Benchmark", 16384, NULL, 1, NULL,
+                             1);
+    return;
+#endif
+
     // Initialize shared variables
-    wind_speed.put (0.0);
-    wind_dir.put (0.0);
+    conditions.put (Conditions {0.0, 0.0, 0.0, 0.0, 0.0, millis ()});
+    net_health.put (NetHealth {0.0, 0.0, 0.0, 0.0, 0, 0, millis ()});
+    vane_angle.put (0.0);
+
+    // Hook up the places where published data goes
+    publisher.add_sink (serial_sink);
+    setup_publisher ();
 
     // Create the task objects; this starts each one immediately
     xTaskCreate (anemometer_task, "Anemometer", 4096, NULL, 7, NULL);
     xTaskCreate (vane_task, "Wind Vane", 2048, NULL, 5, NULL);
-    xTaskCreate (mqtt_task, "MQTT/RSSI", 8192, NULL, 3, NULL);
+    xTaskCreate (turbulence_task, "Turbulence", 8192, NULL, 4, NULL);
+    xTaskCreate (mqtt_task, "MQTT", 8192, NULL, 3, NULL);
+    xTaskCreate (http_task, "HTTP", 4096, NULL, 2, NULL);
     xTaskCreate (temp_humid_task, "Temp/Humid", 1024, NULL, 2, NULL);
     xTaskCreate (serial_task, "Serial", 4096, NULL, 1, NULL);
+    xTaskCreate (nethealth_task, "Net Health", 2048, NULL, 1, NULL);
 }
 
 
@@ -0,0 +1,94 @@
+/** @file mock_i2c.h
+ *  This file contains a stand-in for an Arduino @c TwoWire I2C port which
+ *  answers from an array of registers as one device would. Drivers which are
+ *  templates on their port, such as @c AS5600, can be timed and tested with
+ *  it when no device is attached.
+ */
+
+#ifndef _MOCK_I2C_H_
+#define _MOCK_I2C_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief   Class which acts as an I2C port with one device on it.
+ *  @details The first byte written in each transmission chooses a register
+ *           and later bytes are written to it and the ones after it; reads
+ *           come from the chosen register onwards, as in most I2C devices.
+ */
+class MockI2C
+{
+protected:
+    uint8_t address;                ///< Address of the device which answers
+    uint8_t pointer;                ///< The register to be read or written
+    uint8_t unread;                 ///< Bytes requested but not read yet
+    bool selected;                  ///< True if our device is being written
+    bool choosing;                  ///< True if the next write is a register
+
+public:
+    uint8_t registers[256];         ///< The device's registers
+
+    /** @brief   Create a port with a device whose registers are all zero.
+     *  @param   device_address The device's I2C address
+     */
+    MockI2C (uint8_t device_address)
+        : address (device_address), pointer (0), unread (0), selected (false),
+          choosing (false), registers ()
+    {
+    }
+
+    void beginTransmission (uint8_t device)
+    {
+        selected = (device == address);
+        choosing = selected;
+    }
+
+    size_t write (uint8_t data)
+    {
+        if (!selected)
+        {
+            return 0;
+        }
+        if (choosing)
+        {
+            pointer = data;
+            choosing = false;
+        }
+        else
+        {
+            registers[pointer++] = data;
+        }
+        return 1;
+    }
+
+    /** @return  0 for success, as Wire gives; 2 if nobody answered
+     */
+    uint8_t endTransmission (void)
+    {
+        return selected ? 0 : 2;
+    }
+
+    uint8_t requestFrom (uint8_t device, uint8_t count)
+    {
+        unread = (device == address) ? count : 0;
+        return unread;
+    }
+
+    int available (void)
+    {
+        return unread;
+    }
+
+    int read (void)
+    {
+        if (unread == 0)
+        {
+            return -1;
+        }
+        unread--;
+        return registers[pointer++];
+    }
+};
+
+#endif // _MOCK_I2C_H_
@@ -5,6 +5,7 @@
 
 #include <Arduino.h>
 #include <PubSubClient.h>
+#include "publisher.h"
 
 
 /** @brief   Class which stores data from which to make a Node Red plot.
@@ -25,7 +26,9 @@ public:
     void add_data(float x, float* p_y);
     void print_data(Print& printer);
     void clear(void);
-    void mqtt_send(PubSubClient& client);
+    String to_json(void);
+    bool mqtt_send(PubSubClient& client);
+    uint8_t publish(Publisher& publisher);
 };
 
 
@@ -116,10 +119,10 @@ void NodeRedPlot<num_curves, max_points>::print_data(Print& printer)
 }
 
 
-/** @brief   Send the data in the arrays to Node-RED via an MQTT broker.
+/** @brief   Make the JSON message which Node-RED needs to draw the plot.
  */
 template<uint8_t num_curves, uint16_t max_points>
-void NodeRedPlot<num_curves, max_points>::mqtt_send(PubSubClient& client)
+String NodeRedPlot<num_curves, max_points>::to_json(void)
 {
     // This thing may eat a whole lotta memory. Begin with a header
     String sendstring("[{\"series\":[");
@@ -161,6 +164,18 @@ void NodeRedPlot<num_curves, max_points>::mqtt_send(PubSubClient& client)
     }
     sendstring += "],\"labels\":[\"\"]}]\n";
 
+    return sendstring;
+}
+
+
+/** @brief   Send the data in the arrays to Node-RED via an MQTT broker.
+ *  @return  True if the MQTT client accepted the message
+ */
+template<uint8_t num_curves, uint16_t max_points>
+bool NodeRedPlot<num_curves, max_points>::mqtt_send(PubSubClient& client)
+{
+    String sendstring = to_json();
+
     // Send this big mess to the MQTT broker
     unsigned int howbig = sendstring.length();
     char char_array[howbig];
@@ -170,7 +185,20 @@ void NodeRedPlot<num_curves, max_points>::mqtt_send(PubSubClient& client)
     if (!client.publish(topic_name, char_array))
     {
         Serial << " MQTT Problem! Buffer too small." << endl;
+        return false;
     }
+    return true;
+}
+
+
+/** @brief   Send the data in the arrays to every sink of a publisher.
+ *  @details The message is made once and shared by all the sinks.
+ *  @return  The number of sinks which accepted the message
+ */
+template<uint8_t num_curves, uint16_t max_points>
+uint8_t NodeRedPlot<num_curves, max_points>::publish(Publisher& publisher)
+{
+    return publisher.publish(topic_name, to_json().c_str());
 }
 
 
@@ -0,0 +1,216 @@
+/** @file publish_sinks.cpp
+ *  This file contains the sinks to which the station publishes: MQTT brokers,
+ *  the serial console and a log file in flash.
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "PrintStream.h"
+#include "publish_sinks.h"
+#include "task_nethealth.h"
+
+
+/** @brief   Create a sink which publishes to an MQTT broker.
+ *  @param   broker The IP address (or possibly URL) of the broker
+ *  @param   port The TCP port on the broker, usually 1883
+ *  @param   id The client ID with which to log in
+ *  @param   queue_size The number of messages which may wait in the queue
+ *  @param   drop_policy What to do with a new message when the queue is full
+ *  @param   buffer_size The size of the MQTT client's message buffer
+ */
+MqttSink::MqttSink (const char* broker, uint16_t port, const char* id,
+                    uint8_t queue_size, DropPolicy drop_policy,
+                    uint16_t buffer_size)
+    : PublishSink (queue_size, drop_policy), client (wifi_client)
+{
+    server = broker;
+    client_id = id;
+    subscriptions = NULL;
+    n_subscriptions = 0;
+    last_attempt = 0;
+    probe_topic = NULL;
+    probe_wanted = false;
+    drops_reported = 0;
+    client.setBufferSize (buffer_size);
+    client.setServer (server, port);
+}
+
+
+/** @brief   Set topics to subscribe to and a function to call with messages.
+ *  @details The subscriptions are made each time the sink (re)connects.
+ *  @param   topics An array of topic names, which must stay around
+ *  @param   how_many The number of topics in the array
+ *  @param   callback The function called when a message arrives
+ */
+void MqttSink::subscribe (const char* const* topics, uint8_t how_many,
+                          MQTT_CALLBACK_SIGNATURE)
+{
+    subscriptions = topics;
+    n_subscriptions = how_many;
+    client.setCallback (callback);
+}
+
+
+/** @brief   Make this sink the one whose publishing is reported in the
+ *           network health statistics, and which sends round trip probes.
+ *  @param   echo_topic The topic to which probes are sent; the sink should
+ *           also be subscribed to it so the echoes come back
+ */
+void MqttSink::watch_health (const char* echo_topic)
+{
+    probe_topic = echo_topic;
+}
+
+
+/** @brief   Ask the sink to send a round trip probe.
+ *  @details The probe holds the time in milliseconds at which the sink's task
+ *           actually publishes it, so time spent waiting behind other
+ *           messages isn't counted in the round trip.
+ */
+void MqttSink::probe (void)
+{
+    probe_wanted = true;
+}
+
+
+/** @brief   Publish one message, noting how it went for the network health
+ *           statistics if this sink reports them.
+ */
+bool MqttSink::deliver (const Payload& payload)
+{
+    uint32_t start = micros ();
+    bool success = client.publish (payload.topic, (const uint8_t*)payload.text,
+                                   payload.length);
+    if (probe_topic)
+    {
+        note_publish (success, micros () - start);
+    }
+    return success;
+}
+
+
+/** @brief   Check whether the broker is connected, so messages are left in
+ *           the queue while it isn't.
+ */
+bool MqttSink::ready (void)
+{
+    return client.connected ();
+}
+
+
+/** @brief   Keep the MQTT client running, reconnecting every few seconds if
+ *           the connection has been lost, and send a probe if one is wanted.
+ *  @details Messages which the queue throws away never get to @c deliver(),
+ *           so if this sink reports network health they're counted here; this
+ *           runs while the broker is down, which is when most of them go.
+ */
+void MqttSink::service (void)
+{
+    uint32_t queue_drops = dropped ();
+    if (probe_topic && queue_drops != drops_reported)
+    {
+        note_dropped (queue_drops - drops_reported);
+        drops_reported = queue_drops;
+    }
+
+    if (probe_topic && client.connected () && probe_wanted.exchange (false))
+    {
+        char stamp[12];
+        snprintf (stamp, sizeof (stamp), "%lu", millis ());
+        client.publish (probe_topic, stamp);
+    }
+
+    if (client.loop () || WiFi.status () != WL_CONNECTED
+        || millis () - last_attempt < 5000)
+    {
+        return;
+    }
+
+    last_attempt = millis ();
+    Serial << "Connect to MQTT at " << server << "...";
+    if (client.connect (client_id))
+    {
+        Serial << "connected" << endl;
+        for (uint8_t index = 0; index < n_subscriptions; index++)
+        {
+            client.subscribe (subscriptions[index]);
+        }
+    }
+    else
+    {
+        Serial << "failed, rc=" << client.state () << endl;
+    }
+}
+
+
+/** @brief   Create a sink which prints messages.
+ *  @param   out The serial port or other stream on which to print
+ *  @param   queue_size The number of messages which may wait in the queue
+ *  @param   drop_policy What to do with a new message when the queue is full
+ */
+SerialSink::SerialSink (Print& out, uint8_t queue_size,
+                        DropPolicy drop_policy)
+    : PublishSink (queue_size, drop_policy, 0, portMAX_DELAY), printer (out)
+{
+}
+
+
+/** @brief   Print one message as "topic: message".
+ */
+bool SerialSink::deliver (const Payload& payload)
+{
+    printer << payload.topic << ": " << payload.text << endl;
+    return true;
+}
+
+
+/** @brief   Create a sink which logs messages to a file in flash.
+ *  @param   file_name The name of the log file, such as @c "/publish.log"
+ *  @param   max_size The size in bytes at which the log is rotated
+ *  @param   queue_size The number of messages which may wait in the queue
+ *  @param   drop_policy What to do with a new message when the queue is full
+ */
+FlashLogSink::FlashLogSink (const char* file_name, size_t max_size,
+                            uint8_t queue_size, DropPolicy drop_policy)
+    : PublishSink (queue_size, drop_policy, 0, portMAX_DELAY)
+{
+    path = file_name;
+    max_bytes = max_size;
+    mounted = false;
+}
+
+
+/** @brief   Append one message to the log, rotating the log if it's full.
+ *  @details The file system is mounted here, in the sink's own task, the
+ *           first time a message comes in.
+ */
+bool FlashLogSink::deliver (const Payload& payload)
+{
+    if (!mounted)
+    {
+        mounted = LittleFS.begin (true);
+        if (!mounted)
+        {
+            return false;
+        }
+    }
+
+    File log_file = LittleFS.open (path, FILE_APPEND);
+    if (!log_file)
+    {
+        return false;
+    }
+    log_file << millis () << " " << payload.topic << " " << payload.text
+             << endl;
+    bool full = log_file.size () >= max_bytes;
+    log_file.close ();
+
+    if (full)
+    {
+        String old_path (path);
+        old_path += ".old";
+        LittleFS.remove (old_path);
+        LittleFS.rename (path, old_path);
+    }
+    return true;
+}
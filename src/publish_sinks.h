@@ -0,0 +1,86 @@
+/** @file publish_sinks.h
+ *  This file contains the sinks to which the station publishes: MQTT brokers,
+ *  the serial console and a log file in flash.
+ */
+
+#ifndef _PUBLISH_SINKS_H_
+#define _PUBLISH_SINKS_H_
+
+#include <Arduino.h>
+#include <atomic>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include "publisher.h"
+
+
+/** @brief   Sink which publishes messages to an MQTT broker.
+ *  @details The sink owns its MQTT client and keeps it connected, so a broker
+ *           which is slow or missing only holds up this sink's own task. One
+ *           sink, the one for the main broker, can be made to report how its
+ *           publishing goes for the network health statistics and to send
+ *           round trip probes.
+ */
+class MqttSink : public PublishSink
+{
+protected:
+    WiFiClient wifi_client;             ///< Network connection to the broker
+    PubSubClient client;                ///< The MQTT client itself
+    const char* server;                 ///< Broker's address
+    const char* client_id;              ///< Name by which we log in
+    const char* const* subscriptions;   ///< Topics subscribed after connecting
+    uint8_t n_subscriptions;            ///< Number of them
+    uint32_t last_attempt;              ///< When we last tried to connect
+    const char* probe_topic;            ///< Where probes go; NULL if no health
+    std::atomic<bool> probe_wanted;     ///< True if a probe should be sent
+    uint32_t drops_reported;            ///< Queue drops put into the health
+
+    bool deliver (const Payload& payload);
+    bool ready (void);
+    void service (void);
+
+public:
+    MqttSink (const char* broker, uint16_t port, const char* id,
+              uint8_t queue_size, DropPolicy drop_policy,
+              uint16_t buffer_size = 10000);
+    void subscribe (const char* const* topics, uint8_t how_many,
+                    MQTT_CALLBACK_SIGNATURE);
+    void watch_health (const char* echo_topic);
+    void probe (void);
+};
+
+
+/** @brief   Sink which prints messages on a serial port or other stream.
+ */
+class SerialSink : public PublishSink
+{
+protected:
+    Print& printer;                     ///< Where the messages are printed
+
+    bool deliver (const Payload& payload);
+
+public:
+    SerialSink (Print& out, uint8_t queue_size, DropPolicy drop_policy);
+};
+
+
+/** @brief   Sink which appends messages to a log file in flash.
+ *  @details Each line holds the time in milliseconds since boot, the topic and
+ *           the message. When the file grows past its size limit it's renamed
+ *           with @c ".old" on the end (replacing any older one) and a new
+ *           file is started.
+ */
+class FlashLogSink : public PublishSink
+{
+protected:
+    const char* path;                   ///< Name of the log file
+    size_t max_bytes;                   ///< Size at which the log is rotated
+    bool mounted;                       ///< True once the file system is up
+
+    bool deliver (const Payload& payload);
+
+public:
+    FlashLogSink (const char* file_name, size_t max_size,
+                  uint8_t queue_size, DropPolicy drop_policy);
+};
+
+#endif // _PUBLISH_SINKS_H_
@@ -0,0 +1,200 @@
+/** @file publisher.cpp
+ *  This file contains classes which send each published message to several
+ *  destinations (sinks) such as MQTT brokers, the serial console and a log
+ *  file in flash, each through its own queue so that a slow sink can't hold
+ *  up the others. The sinks themselves are in @c publish_sinks.cpp.
+ */
+
+#include <Arduino.h>
+#include <new>
+#include "publisher.h"
+
+
+/** @brief   Make a payload holding copies of a topic and message.
+ *  @param   topic The topic to which the message is published
+ *  @param   message The message, a NUL terminated string
+ *  @param   holders The number of sinks which will each release it once
+ *  @return  A pointer to the new payload, or @c NULL if memory ran out
+ */
+Payload* Payload::make (const char* topic, const char* message,
+                        uint8_t holders)
+{
+    size_t message_length = strlen (message);
+    size_t topic_length = strlen (topic);
+    void* p_memory = malloc (sizeof (Payload) + message_length
+                             + topic_length + 2);
+    if (!p_memory)
+    {
+        return NULL;
+    }
+
+    Payload* p_payload = new (p_memory) Payload;
+    p_payload->refs = holders;
+    p_payload->length = message_length;
+    memcpy (p_payload->text, message, message_length + 1);
+    memcpy (p_payload->text + message_length + 1, topic, topic_length + 1);
+    p_payload->topic = p_payload->text + message_length + 1;
+    return p_payload;
+}
+
+
+/** @brief   Let go of a payload, freeing it if nobody else holds it.
+ */
+void Payload::release (void)
+{
+    if (refs.fetch_sub (1) == 1)
+    {
+        this->~Payload ();
+        free (this);
+    }
+}
+
+
+/** @brief   Set up a sink's queue and policies.
+ *  @param   queue_size The number of messages which may wait in the queue
+ *  @param   drop_policy What to do with a new message when the queue is full
+ *  @param   block_time For @c BLOCK, how many ticks to wait for room before
+ *           dropping the new message
+ *  @param   service_time The most ticks which may pass between calls to
+ *           @c service()
+ */
+PublishSink::PublishSink (uint8_t queue_size, DropPolicy drop_policy,
+                          TickType_t block_time, TickType_t service_time)
+{
+    queue = xQueueCreate (queue_size, sizeof (Payload*));
+    policy = drop_policy;
+    block_ticks = block_time;
+    service_ticks = service_time;
+    drops = 0;
+}
+
+
+/** @brief   Put a payload into this sink's queue according to its policy.
+ *  @details If the payload can't be queued, the sink's hold on it is released
+ *           and it's counted as dropped.
+ *  @param   p_payload The payload, already counting this sink as a holder
+ *  @return  True if the payload was queued
+ */
+bool PublishSink::offer (Payload* p_payload)
+{
+    TickType_t wait = (policy == BLOCK) ? block_ticks : 0;
+    if (xQueueSendToBack (queue, &p_payload, wait) == pdTRUE)
+    {
+        return true;
+    }
+
+    // Make room by throwing out the oldest message, then try once more
+    if (policy == DROP_OLDEST)
+    {
+        Payload* p_oldest;
+        if (xQueueReceive (queue, &p_oldest, 0) == pdTRUE)
+        {
+            p_oldest->release ();
+            drops++;
+        }
+        if (xQueueSendToBack (queue, &p_payload, 0) == pdTRUE)
+        {
+            return true;
+        }
+    }
+
+    p_payload->release ();
+    drops++;
+    return false;
+}
+
+
+/** @brief   Send a message to this sink only.
+ *  @param   topic The topic to which the message is published
+ *  @param   message The message
+ *  @return  True if the message was queued
+ */
+bool PublishSink::send (const char* topic, const char* message)
+{
+    Payload* p_payload = Payload::make (topic, message, 1);
+    return p_payload && offer (p_payload);
+}
+
+
+/** @brief   Deliver messages from the queue forever; run by the sink's task.
+ *  @details Messages are left in the queue while the sink isn't ready, so a
+ *           sink whose destination is down keeps the messages its policy
+ *           says to keep rather than throwing each one away as it comes.
+ */
+void PublishSink::run (void)
+{
+    Payload* p_payload;
+
+    for (;;)
+    {
+        if (!ready ())
+        {
+            vTaskDelay (service_ticks);
+        }
+        else if (xQueueReceive (queue, &p_payload, service_ticks) == pdTRUE)
+        {
+            deliver (*p_payload);
+            p_payload->release ();
+        }
+        service ();
+    }
+}
+
+
+/** @brief   Task function which runs a sink; the parameter is the sink.
+ */
+void PublishSink::task (void* p_sink)
+{
+    ((PublishSink*)p_sink)->run ();
+}
+
+
+/** @brief   Create a publisher with no sinks.
+ */
+Publisher::Publisher (void)
+{
+    n_sinks = 0;
+}
+
+
+/** @brief   Register a sink to which every message will be sent.
+ *  @return  True if there was room for another sink
+ */
+bool Publisher::add_sink (PublishSink& sink)
+{
+    if (n_sinks >= MAX_SINKS)
+    {
+        return false;
+    }
+    sinks[n_sinks++] = &sink;
+    return true;
+}
+
+
+/** @brief   Send a message to every sink.
+ *  @details This never waits on a sink's delivery, only (for sinks with the
+ *           @c BLOCK policy) for room in its queue.
+ *  @param   topic The topic to which the message is published
+ *  @param   message The message, a NUL terminated string
+ *  @return  The number of sinks which accepted the message
+ */
+uint8_t Publisher::publish (const char* topic, const char* message)
+{
+    if (n_sinks == 0)
+    {
+        return 0;
+    }
+
+    Payload* p_payload = Payload::make (topic, message, n_sinks);
+    if (!p_payload)
+    {
+        return 0;
+    }
+
+    uint8_t accepted = 0;
+    for (uint8_t index = 0; index < n_sinks; index++)
+    {
+        accepted += sinks[index]->offer (p_payload) ? 1 : 0;
+    }
+    return accepted;
+}
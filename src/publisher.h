@@ -0,0 +1,94 @@
+/** @file publisher.h
+ *  This file contains classes which send each published message to several
+ *  destinations (sinks) such as MQTT brokers, the serial console and a log
+ *  file in flash, each through its own queue so that a slow sink can't hold
+ *  up the others. The sinks themselves are in @c publish_sinks.h.
+ */
+
+#ifndef _PUBLISHER_H_
+#define _PUBLISHER_H_
+
+#include <Arduino.h>
+#include <atomic>
+
+
+/** @brief   One encoded message, shared by every sink which is sending it.
+ *  @details A payload is made once by @c Payload::make() and handed to each
+ *           sink's queue as a pointer. Each sink releases the payload when it
+ *           has finished with it, and the last release frees the memory.
+ */
+struct Payload
+{
+    std::atomic<uint8_t> refs;          ///< Sinks still holding the payload
+    uint16_t length;                    ///< Length of the message text
+    const char* topic;                  ///< Topic; points into @c text
+    char text[];                        ///< Message, then the topic, with NULs
+
+    static Payload* make (const char* topic, const char* message,
+                          uint8_t holders);
+    void release (void);
+};
+
+
+/// What a sink does when a message arrives and its queue is full
+enum DropPolicy
+{
+    DROP_NEWEST,            ///< Throw away the message which just arrived
+    DROP_OLDEST,            ///< Throw away the oldest message in the queue
+    BLOCK                   ///< Make the publisher wait a while for room
+};
+
+
+/** @brief   Base class for a destination to which messages are published.
+ *  @details Each sink has a queue of payloads and is emptied by its own task,
+ *           which calls @c deliver() for each message and calls @c service()
+ *           now and then even when there's nothing to send. A message is only
+ *           taken from the queue when @c ready() says the sink can deliver
+ *           it; while a sink isn't ready its queue fills up and its drop
+ *           policy decides which messages are kept.
+ */
+class PublishSink
+{
+protected:
+    QueueHandle_t queue;                ///< Payloads waiting to be delivered
+    DropPolicy policy;                  ///< What to do when the queue is full
+    TickType_t block_ticks;             ///< How long @c BLOCK waits for room
+    TickType_t service_ticks;           ///< Longest wait between services
+    std::atomic<uint32_t> drops;        ///< Messages thrown away so far
+
+    virtual bool deliver (const Payload& payload) = 0;
+    virtual bool ready (void) { return true; }
+    virtual void service (void) { }
+
+public:
+    PublishSink (uint8_t queue_size, DropPolicy drop_policy,
+                 TickType_t block_time = 0, TickType_t service_time = 20);
+    bool offer (Payload* p_payload);
+    bool send (const char* topic, const char* message);
+    void run (void);
+    uint32_t dropped (void) { return drops; }
+    static void task (void* p_sink);
+};
+
+
+/** @brief   Class which hands each message to every registered sink.
+ *  @details The message is copied once into a shared payload no matter how
+ *           many sinks it goes to.
+ */
+class Publisher
+{
+protected:
+    static const uint8_t MAX_SINKS = 4;
+    PublishSink* sinks[MAX_SINKS];      ///< The registered sinks
+    uint8_t n_sinks;                    ///< How many are registered
+
+public:
+    Publisher (void);
+    bool add_sink (PublishSink& sink);
+    uint8_t publish (const char* topic, const char* message);
+};
+
+/// The publisher through which all the station's data goes out
+extern Publisher publisher;
+
+#endif // _PUBLISHER_H_
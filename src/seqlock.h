@@ -0,0 +1,115 @@
+/** @file seqlock.h
+ *  This file contains a template for a sequence-locked shared data item which
+ *  many tasks can read without locking and without getting a torn copy.
+ */
+
+#ifndef _SEQLOCK_H_
+#define _SEQLOCK_H_
+
+#include <Arduino.h>
+#include <atomic>
+
+
+/** @brief   Class which shares a record between tasks using a sequence lock.
+ *  @details A sequence counter is made odd while the record is being written
+ *           and even again when the write is done. A reader copies the record
+ *           and then checks that the counter was even and didn't change
+ *           during the copy; if it did, the reader simply tries again. Readers
+ *           therefore never lock anything and never hold up a writer. Writers
+ *           are serialized among themselves by a spinlock which is held only
+ *           for the few instructions it takes to change the record, so it's
+ *           best to keep @c DataType small and simple (no pointers or
+ *           Arduino @c String objects).
+ */
+template <class DataType>
+class SeqLock
+{
+protected:
+    std::atomic<uint32_t> sequence;     ///< Odd while a write is in progress
+    DataType data;                      ///< The shared record itself
+    portMUX_TYPE writer_mux;            ///< Serializes writers only
+
+public:
+    SeqLock (const DataType& initial = DataType ());
+    void put (const DataType& value);
+    template <class Modifier> void update (Modifier modify);
+    void get (DataType& recv_item);
+    DataType get (void);
+};
+
+
+/** @brief   Create a sequence-locked shared record.
+ *  @param   initial The value with which the record begins
+ */
+template <class DataType>
+SeqLock<DataType>::SeqLock (const DataType& initial)
+    : sequence (0), data (initial)
+{
+    writer_mux = portMUX_INITIALIZER_UNLOCKED;
+}
+
+
+/** @brief   Replace the whole shared record.
+ *  @param   value The new value for the record
+ */
+template <class DataType>
+void SeqLock<DataType>::put (const DataType& value)
+{
+    update ([&value] (DataType& record) { record = value; });
+}
+
+
+/** @brief   Change some fields of the shared record in one atomic step.
+ *  @details The function given is called with a reference to the record while
+ *           the sequence count is odd, so readers will never see a record
+ *           which is only partly updated. Because the spinlock also keeps this
+ *           core from switching tasks, a write can't be left half done while
+ *           a reader on the other core waits for it.
+ *  @param   modify A function or lambda taking a @c DataType reference
+ */
+template <class DataType>
+template <class Modifier>
+void SeqLock<DataType>::update (Modifier modify)
+{
+    portENTER_CRITICAL (&writer_mux);
+    uint32_t count = sequence.load (std::memory_order_relaxed);
+    sequence.store (count + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    modify (data);
+
+    sequence.store (count + 2, std::memory_order_release);
+    portEXIT_CRITICAL (&writer_mux);
+}
+
+
+/** @brief   Get a consistent copy of the shared record without locking.
+ *  @param   recv_item A reference to the variable which receives the copy
+ */
+template <class DataType>
+void SeqLock<DataType>::get (DataType& recv_item)
+{
+    uint32_t before, after;
+    do
+    {
+        before = sequence.load (std::memory_order_acquire);
+        memcpy (&recv_item, (const void*)&data, sizeof (DataType));
+        std::atomic_thread_fence (std::memory_order_acquire);
+        after = sequence.load (std::memory_order_relaxed);
+    }
+    while ((before & 1) || before != after);
+}
+
+
+/** @brief   Get a consistent copy of the shared record without locking.
+ *  @return  A copy of the record
+ */
+template <class DataType>
+DataType SeqLock<DataType>::get (void)
+{
+    DataType copy;
+    get (copy);
+    return copy;
+}
+
+#endif // _SEQLOCK_H_
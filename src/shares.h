@@ -2,7 +2,48 @@
  *  This file contains shared variables and queues for a weather project.
  */
 
+#ifndef _SHARES_H_
+#define _SHARES_H_
+
 #include "taskshare.h"
+#include "taskqueue.h"
+#include "seqlock.h"
+#include "wind_spectrum.h"
+
+
+/** @brief   The most recent set of averaged weather measurements.
+ *  @details Each measuring task updates its own fields; the whole record is
+ *           shared through a sequence lock so that a reader always gets fields
+ *           which were current at the same moment.
+ */
+struct Conditions
+{
+    float wind_speed;             ///< Averaged wind speed in mph
+    float wind_dir;               ///< Averaged wind direction in degrees
+    float gust;                   ///< Highest 3 second wind speed in mph
+    float temperature;            ///< Air temperature in degrees C
+    float humidity;               ///< Relative humidity in percent
+    uint32_t time;                ///< Time of latest update, in ms since boot
+};
+
+
+/** @brief   Moving averages which describe the health of the network link.
+ */
+struct NetHealth
+{
+    float rssi;                   ///< WiFi received signal strength in dBm
+    float broker_rtt_ms;          ///< Round trip time through the broker
+    float publish_ms;             ///< Time taken by each publish call
+    float drop_rate;              ///< Fraction of messages failed or dropped
+    uint32_t publishes;           ///< Messages published, failed or dropped
+    uint32_t drops;               ///< Messages failed or dropped by the queue
+    uint32_t time;                ///< Time of latest update, in ms since boot
+};
+
+extern SeqLock<Conditions> conditions;
+extern SeqLock<NetHealth> net_health;
+extern Share<float> vane_angle;
+extern Queue<float> speed_samples;
+extern Queue<TurbulenceReport> turbulence_reports;
 
-extern Share<float> wind_speed;
-extern Share<float> wind_dir;
+#endif // _SHARES_H_
@@ -7,52 +7,116 @@
 #include "task_anemometer.h"
 
 #include "shares.h"
+#include "calibration.h"
+#include "wind_spectrum.h"
 
 
-const uint8_t RecordTime = 10;      ///< Pulse counting interval (Seconds)
+const uint8_t RecordTime = WIND_RECORD_TIME;  ///< Pulse counting interval (s)
+const uint16_t SampleTime = 500;    ///< Fast sample interval (milliseconds)
+const uint32_t CalmTime = 2000000;  ///< No pulses for this long (us) is calm
 const int SensorPin = 23;           ///< Pin to which C3 anemometer output goes
-int InterruptCounter;               ///< Global used to count anemometer pulses
+volatile int InterruptCounter;      ///< Global used to count anemometer pulses
+volatile uint32_t LastPulseTime;    ///< Time of the latest pulse (us)
 
+/// Spinlock which keeps the ISR from counting while the count is being reset
+portMUX_TYPE counter_mux = portMUX_INITIALIZER_UNLOCKED;
 
-/** @brief   Convert the number of hacked C3 pulses to wind speed in mph.
- *  @details It is assumed that a Hall effect sensor has been placed in the C3
- *           anemometer and produces two pulses per revolution, and that the
- *           pulses have been counted over a 10 second period.
- *           Calibration: m/s = Hz * 0.766 + 0.324
- *                        mph = Hz * 1.714 + 0.725
- */
-inline float sec_to_mph_C3 (uint16_t counts)
-{
-    return (float)counts * 0.1714 + 0.0725;
-}
+
+/// Converts pulse rates in 1/64 Hz steps to wind speed; counting a 64 second
+/// window gives the same table, with steps of about 0.03 mph up to 110 mph
+typedef AnemometerCal<SecondWindC3, Mph, 64000, 4096> RateCal;
+
+/// Converts pulses counted in a whole recording period to wind speed
+typedef AnemometerCal<SecondWindC3, Mph, 1000 * RecordTime> RecordCal;
 
 
 /** @brief   Absurdly simple interrupt service routine that adds up pulses from
- *           the anemometer.
+ *           the anemometer and notes when the latest one came.
  */
-void countup () 
+void IRAM_ATTR countup () 
 {
+    uint32_t now = micros ();
+    portENTER_CRITICAL_ISR (&counter_mux);
     InterruptCounter++;
+    LastPulseTime = now;
+    portEXIT_CRITICAL_ISR (&counter_mux);
 }
 
 
 /** @brief   Task function which controls the anemometer.
+ *  @details Pulses are counted continuously. Every @c SampleTime milliseconds
+ *           a fast wind speed sample is sent to the turbulence task. Counting
+ *           two pulses per turn for half a second would give steps of about
+ *           3.4 mph, which at light winds would swamp the turbulence with
+ *           counting noise, so the fast sample comes instead from the time
+ *           between the latest pulse and the latest one before this sample
+ *           interval, divided by the pulses in between. If no pulse comes in
+ *           an interval, the speed can't be more than one pulse in the time
+ *           since the last one, and after @c CalmTime it's taken to be calm.
+ *           The counts are also totaled over @c RecordTime
+ *           seconds to find the averaged wind speed, and the highest 3 second
+ *           average speed in each period is reported as the gust.
  */
 void anemometer_task (void* p_params)
 {
+    const uint8_t SamplesPerRecord = 1000 * RecordTime / SampleTime;
     float WindSpeed;                      // Local to this task function
+    uint16_t RecordCount = 0;             // Pulses in this recording period
+    uint8_t n_samples = 0;                // Fast samples in this period
+    GustMeter gusts;                      // Finds the highest 3 s average
+    float hertz = 0.0;                    // Latest measured pulse rate
+    uint32_t last_pulse = micros ();      // Time of latest pulse already used
+    TickType_t xLastWakeTime = xTaskGetTickCount ();
+
     pinMode (SensorPin, INPUT_PULLUP);    // Must use pullup for Hall sensor
+    InterruptCounter = 0;
+    attachInterrupt (digitalPinToInterrupt (SensorPin), countup, RISING);
 
     for (;;)
     {
+        vTaskDelayUntil (&xLastWakeTime, SampleTime);
+
+        portENTER_CRITICAL (&counter_mux);
+        uint16_t counts = InterruptCounter;
+        uint32_t pulse_time = LastPulseTime;
         InterruptCounter = 0;
-        attachInterrupt (digitalPinToInterrupt (SensorPin), countup, RISING);
-        vTaskDelay (1000 * RecordTime);
-        detachInterrupt (digitalPinToInterrupt (SensorPin));
+        portEXIT_CRITICAL (&counter_mux);
+
+        uint32_t since_pulse = micros () - last_pulse;
+        if (counts > 0 && pulse_time != last_pulse)
+        {
+            hertz = counts * 1.0e6 / (pulse_time - last_pulse);
+            last_pulse = pulse_time;
+        }
+        else if (since_pulse > CalmTime)
+        {
+            hertz = 0.0;
+        }
+        else if (since_pulse * hertz > 1.0e6)
+        {
+            hertz = 1.0e6 / since_pulse;
+        }
+        float fast_speed = RateCal::convert ((uint16_t)min (hertz * 64.0 + 0.5,
+                                                            65535.0));
+        speed_samples.put (fast_speed);
+
+        gusts.add (fast_speed);
 
-        WindSpeed = sec_to_mph_C3 (InterruptCounter);
-        wind_speed.put (WindSpeed);
+        RecordCount += counts;
+        if (++n_samples >= SamplesPerRecord)
+        {
+            WindSpeed = RecordCal::convert (RecordCount);
+            float Gust = gusts.highest ();
+            conditions.update ([WindSpeed, Gust] (Conditions& now)
+            {
+                now.wind_speed = WindSpeed;
+                now.gust = Gust;
+                now.time = millis ();
+            });
 
-        vTaskDelay (1000);
+            RecordCount = 0;
+            n_samples = 0;
+            gusts.clear ();
+        }
     }
 }
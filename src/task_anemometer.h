@@ -2,5 +2,14 @@
  *  This file contains a task that reads a surplus Second Wind C3 anemometer.
  */
 
+#ifndef _TASK_ANEMOMETER_H_
+#define _TASK_ANEMOMETER_H_
+
+#include <stdint.h>
+
+/// Time over which each recorded wind speed and direction is averaged (s)
+const uint8_t WIND_RECORD_TIME = 10;
+
 void anemometer_task (void* p_params);
 
+#endif // _TASK_ANEMOMETER_H_
@@ -0,0 +1,143 @@
+/** @file task_http.cpp
+ *  This file contains a task which records recent weather conditions and
+ *  serves them to HTTP clients on the local network.
+ *
+ *  A request such as
+ *      GET /history?channel=wind_speed&res=1m&since=3600000
+ *  gets back lines of @c time,value in CSV format, where the time is in
+ *  milliseconds since the station booted. The @c res may be @c 1m or @c 10m
+ *  and defaults to @c 1m; if @c since is given, only records made after that
+ *  time are sent, so a client which polls can ask for just what's new by
+ *  sending the time of the last line it got. The station's current uptime is
+ *  sent in an @c X-Uptime-Ms header. Times wrap around after 49.7 days of
+ *  uptime; a poller can carry on sending the last time it got across the
+ *  wrap, and one whose @c since is later than every record, because the
+ *  station restarted since it last polled, gets every record kept.
+ *
+ *  Looking after each client is done by the code in @c http_history.h.
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "PrintStream.h"
+#include "shares.h"
+#include "history.h"
+#include "http_history.h"
+#include "task_http.h"
+
+
+const uint16_t HttpPort = 80;           ///< TCP port on which to listen
+const uint8_t MaxClients = 4;           ///< Clients which are served at once
+const uint32_t RecordTime = 60000;      ///< Time between records (ms)
+const uint8_t SlowRecords = 10;         ///< 1 minute records per 10 minutes
+
+
+/** @brief   Task which keeps a history of weather conditions and serves it.
+ *  @details Once a minute the current conditions are added to the 1 minute
+ *           history, and every ten minutes their average goes into the 10
+ *           minute history. In between, up to @c MaxClients HTTP clients are
+ *           served, each being sent one chunk in turn. Because the histories
+ *           are only touched by this task, no locking is needed.
+ */
+void http_task (void* p_params)
+{
+    History fast_history (360);             // Six hours of 1 minute records
+    History slow_history (288);             // Two days of 10 minute records
+    HttpSlot<WiFiClient> slots[MaxClients];
+    WiFiServer server (HttpPort);
+    bool listening = false;
+
+    Conditions slow_sum = {0.0, 0.0, 0.0, 0.0, 0.0, 0};
+    float sine_sum = 0.0, cosine_sum = 0.0;
+    uint8_t slow_count = 0;
+    uint32_t last_record = millis ();
+
+    for (uint8_t index = 0; index < MaxClients; index++)
+    {
+        slots[index].active = false;
+    }
+
+    for (;;)
+    {
+        uint32_t now = millis ();
+
+        // Record the current conditions once a minute
+        if (now - last_record >= RecordTime)
+        {
+            last_record += RecordTime;
+            Conditions record;
+            conditions.get (record);
+            record.time = now;
+            fast_history.add (record);
+
+            // Average ten of those for the slow history, direction as vectors
+            slow_sum.wind_speed += record.wind_speed;
+            sine_sum += sin (record.wind_dir * PI / 180.0);
+            cosine_sum += cos (record.wind_dir * PI / 180.0);
+            slow_sum.gust = max (slow_sum.gust, record.gust);
+            slow_sum.temperature += record.temperature;
+            slow_sum.humidity += record.humidity;
+            if (++slow_count >= SlowRecords)
+            {
+                float degrees = atan2 (sine_sum, cosine_sum) * 180.0 / PI;
+                if (degrees < 0.0f)
+                {
+                    degrees += 360.0f;
+                }
+                Conditions average = {slow_sum.wind_speed / SlowRecords,
+                                      degrees,
+                                      slow_sum.gust,
+                                      slow_sum.temperature / SlowRecords,
+                                      slow_sum.humidity / SlowRecords,
+                                      now};
+                slow_history.add (average);
+
+                slow_sum = {0.0, 0.0, 0.0, 0.0, 0.0, 0};
+                sine_sum = 0.0;
+                cosine_sum = 0.0;
+                slow_count = 0;
+            }
+        }
+
+        // The server can't start until the MQTT task has brought up WiFi
+        if (!listening)
+        {
+            if (WiFi.status () == WL_CONNECTED)
+            {
+                server.begin ();
+                listening = true;
+                Serial << "History server at http://" << WiFi.localIP ()
+                       << "/history" << endl;
+            }
+            vTaskDelay (1000);
+            continue;
+        }
+
+        // Take a new client if there's a free slot for it
+        bool busy = false;
+        for (uint8_t index = 0; index < MaxClients; index++)
+        {
+            if (!slots[index].active)
+            {
+                WiFiClient client = server.available ();
+                if (client)
+                {
+                    slots[index].open (client, now);
+                }
+                break;
+            }
+        }
+
+        // Give each client a turn: read its request or send it one chunk
+        for (uint8_t index = 0; index < MaxClients; index++)
+        {
+            if (slots[index].active)
+            {
+                busy = true;
+                serve_slot (slots[index], fast_history, slow_history, now);
+            }
+        }
+
+        vTaskDelay (busy ? 1 : 20);
+    }
+}
@@ -0,0 +1,6 @@
+/** @file task_http.h
+ *  This file contains a task which records recent weather conditions and
+ *  serves them to HTTP clients on the local network.
+ */
+
+void http_task (void* p_params);
@@ -1,6 +1,7 @@
 /** @file task_mqtt.cpp
  *  This file contains a task which communicates measured data to an MQTT
- *  broker out there somewhere.
+ *  broker out there somewhere, and to the other destinations (sinks) which
+ *  the publisher sends everything to.
  */
 
 #include <Arduino.h>
@@ -9,8 +10,10 @@
 #include "task_mqtt.h"
 #include "mycerts.h"
 #include "shares.h"
-#include "ESP32Ping.h"
 #include "node_red_plot.h"
+#include "publisher.h"
+#include "publish_sinks.h"
+#include "task_nethealth.h"
 
 
 /// The IP address (or possibly URL) of your MQTT broker
@@ -19,15 +22,23 @@ const char* mqtt_server = "192.168.2.87";
 /// The TCP/IP port on the broker machine to which we connect, usually 1883
 const uint16_t mqtt_port = 1883;
 
-// The WiFi client, something which is part of the PubSubClient framework
-WiFiClient espClient;
-
-// The MQTT client which publishes data and subscribes to topics
-PubSubClient client(espClient);
+/// A second broker, such as a local Node-RED machine's, which gets a copy
+/// of everything published; set to @c NULL if there isn't one
+const char* local_mqtt_server = NULL;
 
 /// The size of a buffer used internally in the MQTT client
 #define MQTT_BUF_SIZE 10000
 
+/// A topic to which we both publish and subscribe to time round trips
+const char* echo_topic = "travisty/network/echo";
+
+/// Topics to which the main broker's sink subscribes
+const char* const subscriptions[] = {"test/to_ardo", echo_topic};
+
+/// The sink for the main broker, which sends round trip probes and whose
+/// publishing is reported in the network health statistics
+MqttSink* p_broker_sink = NULL;
+
 
 /** @brief   Get the WiFi running so we can talk to the MQTT broker
  */
@@ -55,27 +66,6 @@ void setup_wifi()
 }
 
 
-/** @brief   Find the WiFi received signal strength.
- *  @details Take a bunch of measurements of the Wi-Fi strength and return the
- *           average result.
- *  @param   num_checks The number of measurements to take and average
- */
-int32_t check_RSSI (uint8_t num_checks)
-{
-    int32_t rssi = 0;
-    int32_t average = 0;
-    
-    for (uint8_t count = 0; count < num_checks; count++)
-    {
-        rssi += WiFi.RSSI ();
-        vTaskDelay (100);
-    }
-
-    average = rssi / num_checks;
-    return average;
-}
-
-
 /** @brief   Callback which is actived when a message is received
  *  @details The message must have come to a topic to which we've subscribed.
  *  @param   topic The MQTT topic to which the message applies
@@ -84,6 +74,17 @@ int32_t check_RSSI (uint8_t num_checks)
  */
 void callback (char* topic, byte* message, uint16_t length) 
 {
+    // Echoes of our own round trip probes hold the time they were sent
+    if (strcmp (topic, echo_topic) == 0)
+    {
+        char sent[12];
+        length = length < sizeof (sent) - 1 ? length : sizeof (sent) - 1;
+        memcpy (sent, message, length);
+        sent[length] = '\0';
+        note_broker_rtt (millis () - strtoul (sent, NULL, 10));
+        return;
+    }
+
     Serial.print ("Message arrived on topic: ");
     Serial.print (topic);
     Serial.print (". Message: ");
@@ -98,60 +99,80 @@ void callback (char* topic, byte* message, uint16_t length)
 }
 
 
-/** @brief   Re-connect to an MQTT broker.
- *  @param   client The MQTT client object used on this device
+/** @brief   Publish a turbulence report as one compact JSON message.
+ *  @details The message holds the mean speed, turbulence intensity, gust
+ *           factor, sample rate, number of spectrum segments averaged, and
+ *           the along-wind and cross-wind octave band spectra in mph^2/Hz.
+ *  @param   report The turbulence report to be published
  */
-void reconnect(PubSubClient& client) 
+void publish_turbulence (const TurbulenceReport& report)
 {
-    // Try pinging the server; if it fails, reconnect WiFi
-    Serial << "Pinging server " << mqtt_server << "...";
-    bool success = Ping.ping(mqtt_server, 3);
-    if(!success)
+    char message[320];
+    int length = snprintf (message, sizeof (message),
+                           "{\"mean\":%.2f,\"ti\":%.3f,\"gf\":%.3f,"
+                           "\"fs\":%.1f,\"n\":%u,\"along\":[",
+                           report.mean_speed, report.turb_intensity,
+                           report.gust_factor, report.sample_rate,
+                           report.n_segments);
+
+    for (uint8_t band = 0; band < SPECTRUM_BANDS; band++)
     {
-        Serial << "failed. ";
+        length += snprintf (message + length, sizeof (message) - length,
+                            band ? ",%.3g" : "%.3g", report.along[band]);
     }
-    else
+    length += snprintf (message + length, sizeof (message) - length,
+                        "],\"cross\":[");
+    for (uint8_t band = 0; band < SPECTRUM_BANDS; band++)
     {
-        Serial << "succesful. ";
+        length += snprintf (message + length, sizeof (message) - length,
+                            band ? ",%.3g" : "%.3g", report.cross[band]);
     }
+    snprintf (message + length, sizeof (message) - length, "]}");
 
-    // Loop until we're reconnected
-    while (!client.connected()) 
-    {
-        Serial.print("Connect to MQTT...");
+    publisher.publish ("travisty/weather/turbulence", message);
+}
 
-        if (client.connect("ESP32_Wx"))           // Attempt to connect
-        {
-            Serial.println("connected");
-            client.subscribe("test/to_ardo");
-        }
-        else
-        {
-            // Complain, then try restarting the network connection
-            Serial << "failed, rc=" << client.state() << endl;
-            if (!Ping.ping(mqtt_server, 3))
-            {
-                setup_wifi();
-            }
-            vTaskDelay(5000);
-        }
+
+/** @brief   Create the MQTT and flash log sinks and start their tasks.
+ *  @details Each sink gets its own task, so a broker which is slow or down,
+ *           or a busy flash chip, only delays messages going to that sink.
+ *           This should be called from @c setup() before the tasks which
+ *           publish are started.
+ */
+void setup_publisher (void)
+{
+    p_broker_sink = new MqttSink (mqtt_server, mqtt_port, "ESP32_Wx", 16,
+                                  DROP_OLDEST, MQTT_BUF_SIZE);
+    p_broker_sink->subscribe (subscriptions, 2, callback);
+    p_broker_sink->watch_health (echo_topic);
+    publisher.add_sink (*p_broker_sink);
+    xTaskCreate (PublishSink::task, "MQTT Sink", 8192, p_broker_sink, 3,
+                 NULL);
+
+    if (local_mqtt_server)
+    {
+        MqttSink* p_local = new MqttSink (local_mqtt_server, mqtt_port,
+                                          "ESP32_Wx", 16, DROP_OLDEST,
+                                          MQTT_BUF_SIZE);
+        publisher.add_sink (*p_local);
+        xTaskCreate (PublishSink::task, "Local Sink", 8192, p_local, 3, NULL);
     }
+
+    FlashLogSink* p_log = new FlashLogSink ("/publish.log", 65536, 8,
+                                            DROP_OLDEST);
+    publisher.add_sink (*p_log);
+    xTaskCreate (PublishSink::task, "Flash Log", 4096, p_log, 1, NULL);
 }
 
 
-/** @brief   Task which publishes data to an MQTT server.
+/** @brief   Task which gathers data and publishes it through the publisher.
+ *  @details This task only keeps the WiFi up and assembles messages; the
+ *           sinks' own tasks deliver them.
  */
 void mqtt_task (void* p_params)
 {
     uint8_t time_counter = 0;       // Counts seconds between publishing runs
-    // char a_string[64];              // Assemble an MQTT message here
-
-    Serial << "Setting up MQTT server and callback...";
-    client.setBufferSize(MQTT_BUF_SIZE);
-    client.setServer (mqtt_server, 1883);
-    client.setCallback (callback);
-    Serial << "done." << endl;
-
+    char a_string[96];              // Assemble an MQTT message here
 
     const uint16_t ARRAY_SIZE = 10;
     uint32_t times[ARRAY_SIZE];
@@ -170,12 +191,6 @@ void mqtt_task (void* p_params)
             setup_wifi ();
         }
 
-        // Make sure this MQTT client is connected to the MQTT broker
-        if (!client.loop ())
-        {
-            reconnect (client);
-        }
-
         for (uint16_t count = 0; count < ARRAY_SIZE; count++)
         {
             float sineful = sin((float)count / 7);
@@ -188,18 +203,39 @@ void mqtt_task (void* p_params)
             blah[0] = sineful;
             blah[1] = cosful;
             plotzy.add_data(count, blah);
-            plotzy.mqtt_send(client);
+            plotzy.publish(publisher);
 
             vTaskDelay(5000);
         }
         plotzy.clear();
 
-        //     sprintf (a_string, "%.1f,%.1f", wind_speed.get(), wind_dir.get());
-        //     client.publish("travisty/weather/test", a_string);
+        // Publish the latest turbulence report if one has come in
+        TurbulenceReport report;
+        if (turbulence_reports.any ())
+        {
+            turbulence_reports.get (report);
+            publish_turbulence (report);
+        }
 
-        //     sprintf (a_string, "%d", check_RSSI (8));
-        //     client.publish("travisty/network/rssi", a_string);
-        // }
+        // Publish one consistent snapshot of the current conditions
+        Conditions now;
+        conditions.get (now);
+        snprintf (a_string, sizeof (a_string), "%.1f,%.1f,%.1f,%.1f,%.1f,%lu",
+                  now.wind_speed, now.wind_dir, now.gust, now.temperature,
+                  now.humidity, (unsigned long)now.time);
+        publisher.publish ("travisty/weather/test", a_string);
+
+        // Publish the network health averages and send a new round trip
+        // probe, whose echo will be timed whenever it comes back
+        NetHealth health;
+        net_health.get (health);
+        snprintf (a_string, sizeof (a_string),
+                  "{\"rssi\":%.1f,\"rtt\":%.1f,\"pub\":%.2f,\"drop\":%.3f}",
+                  health.rssi, health.broker_rtt_ms, health.publish_ms,
+                  health.drop_rate);
+        publisher.publish ("travisty/network/health", a_string);
+
+        p_broker_sink->probe ();
 
         vTaskDelay (1000);
     }
@@ -7,4 +7,5 @@
 #include "PrintStream.h"
 
 
+void setup_publisher (void);
 void mqtt_task (void* p_params);
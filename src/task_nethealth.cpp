@@ -0,0 +1,113 @@
+/** @file task_nethealth.cpp
+ *  This file contains a low priority task which keeps track of the health of
+ *  the network connection, and functions with which the MQTT task reports
+ *  how its messages are faring.
+ *
+ *  All the measurements are exponentially weighted moving averages kept in
+ *  the sequence-locked @c net_health share, so the MQTT task can publish them
+ *  without ever waiting for a measurement to be made.
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "shares.h"
+#include "task_nethealth.h"
+
+
+const uint16_t RssiTime = 1000;         ///< Time between RSSI readings (ms)
+const float RssiWeight = 0.1;           ///< Weight of each new RSSI reading
+const float RttWeight = 0.2;            ///< Weight of each new round trip time
+const float PublishWeight = 0.05;       ///< Weight of each publish's results
+
+
+/** @brief   Mix a new measurement into a moving average.
+ *  @details The first measurement simply becomes the average, so it doesn't
+ *           take a long time to climb up from zero.
+ */
+inline float ewma (float average, float sample, float weight, bool first)
+{
+    return first ? sample : average + weight * (sample - average);
+}
+
+
+/** @brief   Record how a publish attempt went.
+ *  @details This is called by the MQTT task each time it publishes. It takes
+ *           only as long as it takes to update the share.
+ *  @param   success True if the MQTT client accepted the message
+ *  @param   micros_taken How long the publish call took, in microseconds
+ */
+void note_publish (bool success, uint32_t micros_taken)
+{
+    net_health.update ([success, micros_taken] (NetHealth& health)
+    {
+        bool first = health.publishes == 0;
+        health.publish_ms = ewma (health.publish_ms, micros_taken / 1000.0,
+                                  PublishWeight, first);
+        health.drop_rate = ewma (health.drop_rate, success ? 0.0 : 1.0,
+                                 PublishWeight, first);
+        health.publishes++;
+        health.drops += success ? 0 : 1;
+        health.time = millis ();
+    });
+}
+
+
+/** @brief   Record messages which were thrown away without being published.
+ *  @details The broker's sink calls this with the messages its queue dropped,
+ *           as it does while the broker is down, so an outage shows up in the
+ *           drop rate. Each counts as a failed publish; the moving average is
+ *           moved for all of them at once.
+ *  @param   count The number of messages dropped since the last call
+ */
+void note_dropped (uint32_t count)
+{
+    net_health.update ([count] (NetHealth& health)
+    {
+        float kept = health.publishes ? 1.0 - health.drop_rate : 0.0;
+        health.drop_rate = 1.0 - kept * powf (1.0 - PublishWeight, count);
+        health.publishes += count;
+        health.drops += count;
+        health.time = millis ();
+    });
+}
+
+
+/** @brief   Record the round trip time of a message to the broker and back.
+ *  @param   millis_taken The round trip time in milliseconds
+ */
+void note_broker_rtt (uint32_t millis_taken)
+{
+    net_health.update ([millis_taken] (NetHealth& health)
+    {
+        health.broker_rtt_ms = ewma (health.broker_rtt_ms, millis_taken,
+                                     RttWeight, health.broker_rtt_ms == 0.0);
+        health.time = millis ();
+    });
+}
+
+
+/** @brief   Task which samples the WiFi signal strength in the background.
+ *  @details This replaces stopping the MQTT task to take a burst of RSSI
+ *           readings; here one reading is taken each second at low priority
+ *           and folded into a moving average.
+ */
+void nethealth_task (void* p_params)
+{
+    bool first = true;
+
+    for (;;)
+    {
+        if (WiFi.status () == WL_CONNECTED)
+        {
+            float rssi = WiFi.RSSI ();
+            net_health.update ([rssi, first] (NetHealth& health)
+            {
+                health.rssi = ewma (health.rssi, rssi, RssiWeight, first);
+                health.time = millis ();
+            });
+            first = false;
+        }
+
+        vTaskDelay (RssiTime);
+    }
+}
@@ -0,0 +1,10 @@
+/** @file task_nethealth.h
+ *  This file contains a low priority task which keeps track of the health of
+ *  the network connection, and functions with which the MQTT task reports
+ *  how its messages are faring.
+ */
+
+void nethealth_task (void* p_params);
+void note_publish (bool success, uint32_t micros_taken);
+void note_dropped (uint32_t count);
+void note_broker_rtt (uint32_t millis_taken);
@@ -0,0 +1,44 @@
+/** @file task_turbulence.cpp
+ *  This file contains a task which computes turbulence statistics and a
+ *  coarse wind spectrum from fast wind speed and direction samples.
+ */
+
+#include <Arduino.h>
+#include "PrintStream.h"
+#include "shares.h"
+#include "wind_spectrum.h"
+#include "task_turbulence.h"
+
+
+const float SampleRate = 2.0;          ///< Rate of fast speed samples (Hz)
+const uint16_t ReportTime = 600;       ///< Time between reports (seconds)
+
+
+/** @brief   Task which pairs each fast wind speed sample with the current vane
+ *           angle and, every ten minutes, sends a turbulence report off to be
+ *           published.
+ *  @details The anemometer task sets the pace; this task waits for each of
+ *           its sub-second speed samples in the @c speed_samples queue.
+ */
+void turbulence_task (void* p_params)
+{
+    WindSpectrum spectrum (SampleRate);
+    TurbulenceReport report;
+    uint16_t count = 0;
+    float speed;
+
+    for (;;)
+    {
+        speed_samples.get (speed);
+        spectrum.add_sample (speed, vane_angle.get ());
+
+        if (++count >= ReportTime * SampleRate && spectrum.ready ())
+        {
+            count = 0;
+            spectrum.report (report);
+            spectrum.clear ();
+
+            turbulence_reports.put (report);
+        }
+    }
+}
@@ -0,0 +1,6 @@
+/** @file task_turbulence.h
+ *  This file contains a task which computes turbulence statistics and a
+ *  coarse wind spectrum from fast wind speed and direction samples.
+ */
+
+void turbulence_task (void* p_params);
@@ -7,6 +7,8 @@
 #include "PrintStream.h"
 #include "AS5600.h"
 #include "shares.h"
+#include "calibration.h"
+#include "angle_average.h"
 #include "task_vane.h"
 
 
@@ -15,9 +17,8 @@
  */
 void vane_task (void* p_params)
 {
-    float sine_sum = 0.0, cosine_sum = 0.0;       // To find average wind angle
-    float num_points;
-    uint8_t count = 0;
+    AngleAverage angles;                          // To find average wind angle
+    uint16_t count = 0;
     TickType_t xLastWakeTime = xTaskGetTickCount();
 
     Wire.begin (21, 22);
@@ -26,35 +27,33 @@ void vane_task (void* p_params)
     for (;;)
     {
         // Find the angle now and add its trig functions into averaging sums
-        float angle = angler.getAngle () * 360.0 / 4095.0;
+        float angle = VaneCal<AS5600Vane, Degrees>::convert (
+                          angler.getAngle ());
+        vane_angle.put (angle);
 
-        sine_sum += sin (angle * PI / 180.0);
-        cosine_sum += cos (angle * PI / 180.0);
+        angles.add (angle);
 
         // Periodically report the moving average by serial port for debugging 
         if (++count % 25 == 0)
         {
-            float avg_angle = atan2 (sine_sum, cosine_sum);
-            avg_angle = (avg_angle > 0.0) ? avg_angle : avg_angle + (2 * PI);
-
-            Serial << "Angle: " << avg_angle * 180.0 / PI << endl;
+            Serial << "Angle: " << angles.average () << endl;
         }
 
-        // Periodically send the averaged value to the MQTT task for publishing
-        if (count % 600)    // 600 --> 2 min.
+        // Put the average over each recording period into the conditions
+        if (count >= VANE_AVERAGE_COUNT)
         {
             count = 0;
 
-            float avg_angle = atan2 (sine_sum, cosine_sum);
-            avg_angle = (avg_angle > 0.0) ? avg_angle : avg_angle + (2 * PI);
-
-            sine_sum = 0.0;
-            cosine_sum = 0.0;
-
-            wind_dir.put (avg_angle * 180.0 / PI );
+            float degrees = angles.average ();
+            angles.clear ();
+            conditions.update ([degrees] (Conditions& now)
+            {
+                now.wind_dir = degrees;
+                now.time = millis ();
+            });
         }
 
-        vTaskDelayUntil (&xLastWakeTime, 200);      // Five readings per second
+        vTaskDelayUntil (&xLastWakeTime, VANE_PERIOD);
     }
 }
 
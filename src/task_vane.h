@@ -3,7 +3,17 @@
  *  given time period.
  */
 
-#include "Wire.h"
+#ifndef _TASK_VANE_H_
+#define _TASK_VANE_H_
 
+#include "task_anemometer.h"
+
+const uint16_t VANE_PERIOD = 200;       ///< Time between vane readings (ms)
+
+/// Readings averaged for each recorded direction, which covers the same time
+/// as each recorded wind speed so the two go together
+const uint16_t VANE_AVERAGE_COUNT = 1000U * WIND_RECORD_TIME / VANE_PERIOD;
 
 void vane_task (void* p_params);
+
+#endif // _TASK_VANE_H_
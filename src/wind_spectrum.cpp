@@ -0,0 +1,353 @@
+/** @file wind_spectrum.cpp
+ *  This file contains a class which computes turbulence statistics and a
+ *  coarse power spectrum from a stream of horizontal wind samples.
+ */
+
+#include <Arduino.h>
+#include "wind_spectrum.h"
+
+// Use the SIMD optimized FFT from ESP-DSP if the framework provides it
+#if defined(__has_include)
+    #if __has_include(<esp_dsp.h>)
+        #include <esp_dsp.h>
+        #define SPECTRUM_USE_ESP_DSP
+    #endif
+#endif
+
+static_assert ((1 << SPECTRUM_BANDS) == SPECTRUM_SEG_SIZE / 2,
+               "Spectrum needs one octave band per power of two FFT bin");
+
+
+// Tables shared by all spectrum objects, computed once when first needed
+float WindSpectrum::fft_data[2 * SPECTRUM_SEG_SIZE];
+float WindSpectrum::twiddles[SPECTRUM_SEG_SIZE];
+float WindSpectrum::window[SPECTRUM_SEG_SIZE];
+float WindSpectrum::window_power = 0.0;
+bool WindSpectrum::tables_ready = false;
+
+
+/** @brief   Create a gust meter with an empty ring.
+ */
+GustMeter::GustMeter (void)
+{
+    for (uint8_t index = 0; index < GUST_SAMPLES; index++)
+    {
+        ring[index] = 0.0;
+    }
+    sum = 0.0;
+    count = 0;
+    peak = 0.0;
+}
+
+
+/** @brief   Add a speed, updating the gust once the ring has filled up.
+ *  @param   speed The wind speed
+ */
+void GustMeter::add (float speed)
+{
+    sum += speed - ring[count % GUST_SAMPLES];
+    ring[count % GUST_SAMPLES] = speed;
+    if (++count >= GUST_SAMPLES && sum / GUST_SAMPLES > peak)
+    {
+        peak = sum / GUST_SAMPLES;
+    }
+}
+
+
+/** @brief   Start looking for a new gust.
+ */
+void GustMeter::clear (void)
+{
+    peak = 0.0;
+}
+
+
+/** @brief   Create a wind spectrum analyzer for samples taken at a given rate.
+ *  @param   rate The rate at which samples will be supplied, in Hz
+ */
+WindSpectrum::WindSpectrum (float rate)
+{
+    sample_rate = rate;
+    make_tables ();
+
+    for (uint16_t index = 0; index < SPECTRUM_SEG_SIZE; index++)
+    {
+        u_ring[index] = 0.0;
+        v_ring[index] = 0.0;
+    }
+    ring_index = 0;
+    since_segment = 0;
+    n_total = 0;
+
+    clear ();
+}
+
+
+/** @brief   Compute the twiddle factors and window used by every segment.
+ *  @details The twiddle table holds @c exp(-2*pi*j*k/N) as interleaved real
+ *           and imaginary parts for @c k from 0 to @c N/2 - 1.
+ */
+void WindSpectrum::make_tables (void)
+{
+    if (tables_ready)
+    {
+        return;
+    }
+
+    window_power = 0.0;
+    for (uint16_t index = 0; index < SPECTRUM_SEG_SIZE; index++)
+    {
+        float phase = 2.0 * PI * index / SPECTRUM_SEG_SIZE;
+        window[index] = 0.5 - 0.5 * cos (phase);
+        window_power += window[index] * window[index];
+
+        if (index < SPECTRUM_SEG_SIZE / 2)
+        {
+            twiddles[2 * index] = cos (phase);
+            twiddles[2 * index + 1] = -sin (phase);
+        }
+    }
+
+#ifdef SPECTRUM_USE_ESP_DSP
+    dsps_fft2r_init_fc32 (NULL, SPECTRUM_SEG_SIZE);
+#endif
+
+    tables_ready = true;
+}
+
+
+/** @brief   Compute an in-place complex FFT of @c SPECTRUM_SEG_SIZE points.
+ *  @details The portable version reorders the data by bit reversal, then runs
+ *           pairs of radix-2 stages fused into radix-4 butterflies, finishing
+ *           with one radix-2 stage if the number of stages is odd.
+ *  @param   p_data Interleaved real and imaginary parts of the data
+ */
+void WindSpectrum::fft (float* p_data)
+{
+#ifdef SPECTRUM_USE_ESP_DSP
+    dsps_fft2r_fc32 (p_data, SPECTRUM_SEG_SIZE);
+    dsps_bit_rev_fc32 (p_data, SPECTRUM_SEG_SIZE);
+#else
+    const uint16_t N = SPECTRUM_SEG_SIZE;
+
+    // Bit-reversal permutation
+    for (uint16_t i = 1, j = 0; i < N; i++)
+    {
+        uint16_t bit = N >> 1;
+        for ( ; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j |= bit;
+        if (i < j)
+        {
+            float temp = p_data[2 * i];
+            p_data[2 * i] = p_data[2 * j];
+            p_data[2 * j] = temp;
+            temp = p_data[2 * i + 1];
+            p_data[2 * i + 1] = p_data[2 * j + 1];
+            p_data[2 * j + 1] = temp;
+        }
+    }
+
+    // Radix-4 butterflies, each doing the work of two radix-2 stages
+    uint16_t half = 1;
+    for ( ; 4 * half <= N; half *= 4)
+    {
+        uint16_t stride = N / (4 * half);
+        for (uint16_t j = 0; j < half; j++)
+        {
+            float w2r = twiddles[2 * j * stride];
+            float w2i = twiddles[2 * j * stride + 1];
+            float w1r = twiddles[4 * j * stride];
+            float w1i = twiddles[4 * j * stride + 1];
+
+            for (uint16_t k = j; k < N; k += 4 * half)
+            {
+                float* x0 = p_data + 2 * k;
+                float* x1 = x0 + 2 * half;
+                float* x2 = x1 + 2 * half;
+                float* x3 = x2 + 2 * half;
+
+                // First radix-2 stage on pairs (x0, x1) and (x2, x3)
+                float b1r = w1r * x1[0] - w1i * x1[1];
+                float b1i = w1r * x1[1] + w1i * x1[0];
+                float b3r = w1r * x3[0] - w1i * x3[1];
+                float b3i = w1r * x3[1] + w1i * x3[0];
+                float a0r = x0[0] + b1r, a0i = x0[1] + b1i;
+                float a1r = x0[0] - b1r, a1i = x0[1] - b1i;
+                float a2r = x2[0] + b3r, a2i = x2[1] + b3i;
+                float a3r = x2[0] - b3r, a3i = x2[1] - b3i;
+
+                // Second stage; the (x1, x3) pair's twiddle has an extra -j
+                float c2r = w2r * a2r - w2i * a2i;
+                float c2i = w2r * a2i + w2i * a2r;
+                float c3r = w2r * a3i + w2i * a3r;
+                float c3i = -(w2r * a3r - w2i * a3i);
+
+                x0[0] = a0r + c2r;  x0[1] = a0i + c2i;
+                x2[0] = a0r - c2r;  x2[1] = a0i - c2i;
+                x1[0] = a1r + c3r;  x1[1] = a1i + c3i;
+                x3[0] = a1r - c3r;  x3[1] = a1i - c3i;
+            }
+        }
+    }
+
+    // One radix-2 stage is left over when log2(N) is odd
+    if (2 * half == N)
+    {
+        for (uint16_t j = 0; j < half; j++)
+        {
+            float wr = twiddles[2 * j];
+            float wi = twiddles[2 * j + 1];
+            float* x0 = p_data + 2 * j;
+            float* x1 = x0 + 2 * half;
+            float br = wr * x1[0] - wi * x1[1];
+            float bi = wr * x1[1] + wi * x1[0];
+            x1[0] = x0[0] - br;  x1[1] = x0[1] - bi;
+            x0[0] += br;         x0[1] += bi;
+        }
+    }
+#endif
+}
+
+
+/** @brief   Add one wind sample to the analysis.
+ *  @param   speed The wind speed in mph
+ *  @param   direction The direction from which the wind blows in degrees
+ */
+void WindSpectrum::add_sample (float speed, float direction)
+{
+    float radians = direction * PI / 180.0;
+    u_ring[ring_index] = -speed * sin (radians);
+    v_ring[ring_index] = -speed * cos (radians);
+    ring_index = (ring_index + 1) % SPECTRUM_SEG_SIZE;
+
+    // Keep statistics for the turbulence intensity and gust factor
+    n_samples++;
+    speed_sum += speed;
+    speed_sq_sum += (double)speed * speed;
+    gusts.add (speed);
+    n_total++;
+
+    // Transform a segment once enough new data has come in to fill one
+    if (++since_segment >= SPECTRUM_HOP && n_total >= SPECTRUM_SEG_SIZE)
+    {
+        since_segment = 0;
+        do_segment ();
+    }
+}
+
+
+/** @brief   Transform the most recent segment and add it to the spectra.
+ */
+void WindSpectrum::do_segment (void)
+{
+    const uint16_t N = SPECTRUM_SEG_SIZE;
+
+    // Rotate into along-wind and cross-wind components using the mean wind
+    float u_mean = 0.0, v_mean = 0.0;
+    for (uint16_t index = 0; index < N; index++)
+    {
+        u_mean += u_ring[index];
+        v_mean += v_ring[index];
+    }
+    u_mean /= N;
+    v_mean /= N;
+    float heading = atan2 (v_mean, u_mean);
+    float c = cos (heading);
+    float s = sin (heading);
+    float along_mean = u_mean * c + v_mean * s;
+    float cross_mean = v_mean * c - u_mean * s;
+
+    // Pack along-wind as the real part and cross-wind as the imaginary part,
+    // starting with the oldest sample in the ring
+    for (uint16_t index = 0; index < N; index++)
+    {
+        uint16_t ring = (ring_index + index) % N;
+        float along = u_ring[ring] * c + v_ring[ring] * s - along_mean;
+        float cross = v_ring[ring] * c - u_ring[ring] * s - cross_mean;
+        fft_data[2 * index] = along * window[index];
+        fft_data[2 * index + 1] = cross * window[index];
+    }
+
+    fft (fft_data);
+
+    // Separate the two real signals' spectra: A = (Z[k] + Z*[N-k]) / 2 and
+    // C = (Z[k] - Z*[N-k]) / 2j, then scale to a one-sided density
+    float scale = 1.0 / (4.0 * sample_rate * window_power);
+    for (uint16_t k = 0; k <= N / 2; k++)
+    {
+        uint16_t m = (N - k) % N;
+        float ar = fft_data[2 * k] + fft_data[2 * m];
+        float ai = fft_data[2 * k + 1] - fft_data[2 * m + 1];
+        float cr = fft_data[2 * k + 1] + fft_data[2 * m + 1];
+        float ci = fft_data[2 * k] - fft_data[2 * m];
+        float one_sided = (k == 0 || k == N / 2) ? scale : 2.0 * scale;
+
+        along_sum[k] += (ar * ar + ai * ai) * one_sided;
+        cross_sum[k] += (cr * cr + ci * ci) * one_sided;
+    }
+    n_segments++;
+}
+
+
+/** @brief   Check whether at least one segment has been transformed.
+ *  @return  True if a report would contain a spectrum
+ */
+bool WindSpectrum::ready (void)
+{
+    return n_segments > 0;
+}
+
+
+/** @brief   Fill a report with the statistics gathered since the last clear.
+ *  @param   result The report into which results are written
+ */
+void WindSpectrum::report (TurbulenceReport& result)
+{
+    float mean = n_samples ? speed_sum / n_samples : 0.0;
+    float variance = n_samples ? speed_sq_sum / n_samples - mean * mean : 0.0;
+
+    result.mean_speed = mean;
+    result.turb_intensity = (mean > 0.0 && variance > 0.0)
+                            ? sqrt (variance) / mean : 0.0;
+    result.gust_factor = (mean > 0.0) ? gusts.highest () / mean : 0.0;
+    result.sample_rate = sample_rate;
+    result.n_segments = n_segments;
+
+    for (uint8_t band = 0; band < SPECTRUM_BANDS; band++)
+    {
+        uint16_t first = 1 << band;
+        uint16_t last = (band == SPECTRUM_BANDS - 1) ? SPECTRUM_SEG_SIZE / 2
+                                                     : (2 << band) - 1;
+        float along = 0.0, cross = 0.0;
+        for (uint16_t k = first; k <= last; k++)
+        {
+            along += along_sum[k];
+            cross += cross_sum[k];
+        }
+        float divisor = (float)(last - first + 1) * (n_segments ? n_segments : 1);
+        result.along[band] = along / divisor;
+        result.cross[band] = cross / divisor;
+    }
+}
+
+
+/** @brief   Start a new analysis period.
+ *  @details The ring of recent samples is kept so that the next segment can
+ *           overlap the end of this period.
+ */
+void WindSpectrum::clear (void)
+{
+    n_samples = 0;
+    speed_sum = 0.0;
+    speed_sq_sum = 0.0;
+    gusts.clear ();
+    n_segments = 0;
+    for (uint16_t k = 0; k <= SPECTRUM_SEG_SIZE / 2; k++)
+    {
+        along_sum[k] = 0.0;
+        cross_sum[k] = 0.0;
+    }
+}
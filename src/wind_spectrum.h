@@ -0,0 +1,117 @@
+/** @file wind_spectrum.h
+ *  This file contains a class which computes turbulence statistics and a
+ *  coarse power spectrum from a stream of horizontal wind samples.
+ */
+
+#ifndef _WIND_SPECTRUM_H_
+#define _WIND_SPECTRUM_H_
+
+#include <Arduino.h>
+
+
+/// Number of samples in each FFT segment; must be a power of two
+const uint16_t SPECTRUM_SEG_SIZE = 256;
+
+/// Number of new samples between the starts of overlapping segments (50%)
+const uint16_t SPECTRUM_HOP = SPECTRUM_SEG_SIZE / 2;
+
+/// Number of octave-wide frequency bands in a published spectrum
+const uint8_t SPECTRUM_BANDS = 7;
+
+/// Number of samples over which gusts are averaged (3 s at 2 Hz)
+const uint8_t GUST_SAMPLES = 6;
+
+
+/** @brief   Class which finds the highest 3 second average wind speed.
+ *  @details Speeds sampled at 2 Hz go into a ring holding the last
+ *           @c GUST_SAMPLES of them, and the highest average of the ring
+ *           since the last @c clear() is the gust. The ring is kept across a
+ *           clear so that a gust can span the start of a new period.
+ */
+class GustMeter
+{
+protected:
+    float ring[GUST_SAMPLES];               ///< Recent speeds
+    float sum;                              ///< Sum of @c ring contents
+    uint32_t count;                         ///< Speeds ever added
+    float peak;                             ///< Highest average since clear
+
+public:
+    GustMeter (void);
+    void add (float speed);
+    void clear (void);
+
+    /// Get the highest 3 second average speed since the last clear
+    float highest (void) { return peak; }
+};
+
+
+/** @brief   Results of one turbulence analysis period.
+ *  @details Band powers are one-sided power spectral densities in
+ *           (mph)^2 / Hz, averaged over each octave band. Band @c b covers
+ *           FFT bins @c 2^b up to @c 2^(b+1) - 1; the last band also takes
+ *           the Nyquist bin.
+ */
+struct TurbulenceReport
+{
+    float mean_speed;                 ///< Mean wind speed over period (mph)
+    float turb_intensity;             ///< Standard deviation / mean speed
+    float gust_factor;                ///< Peak 3 second speed / mean speed
+    float sample_rate;                ///< Rate at which samples were taken (Hz)
+    uint16_t n_segments;              ///< Number of FFT segments averaged
+    float along[SPECTRUM_BANDS];      ///< Along-wind spectrum by band
+    float cross[SPECTRUM_BANDS];      ///< Cross-wind spectrum by band
+};
+
+
+/** @brief   Class which accumulates wind samples and computes a spectrum.
+ *  @details Speed and direction samples are converted into (u, v) components
+ *           and kept in a ring buffer. Each time @c SPECTRUM_HOP new samples
+ *           have arrived, the latest @c SPECTRUM_SEG_SIZE of them are rotated
+ *           into along-wind and cross-wind components, Hann windowed, and
+ *           transformed together by one complex FFT with the along-wind part
+ *           as the real input and the cross-wind part as the imaginary input.
+ *           The two one-sided spectra are then separated and averaged over
+ *           the segments (Welch's method). The FFT uses ESP-DSP when the
+ *           library is available and a portable radix-4/radix-2 kernel
+ *           otherwise.
+ */
+class WindSpectrum
+{
+protected:
+    float sample_rate;                      ///< Sampling rate in Hz
+    float u_ring[SPECTRUM_SEG_SIZE];        ///< Recent eastward components
+    float v_ring[SPECTRUM_SEG_SIZE];        ///< Recent northward components
+    uint16_t ring_index;                    ///< Where next sample goes
+    uint16_t since_segment;                 ///< Samples since last segment
+
+    GustMeter gusts;                        ///< Finds the gust factor's peak
+
+    uint32_t n_total;                       ///< Samples ever added
+    uint32_t n_samples;                     ///< Samples in this period
+    double speed_sum;                       ///< Sum of speeds
+    double speed_sq_sum;                    ///< Sum of squared speeds
+
+    float along_sum[SPECTRUM_SEG_SIZE / 2 + 1];  ///< Summed along-wind PSD
+    float cross_sum[SPECTRUM_SEG_SIZE / 2 + 1];  ///< Summed cross-wind PSD
+    uint16_t n_segments;                         ///< Segments in the sums
+
+    static float fft_data[2 * SPECTRUM_SEG_SIZE];      ///< Interleaved re, im
+    static float twiddles[SPECTRUM_SEG_SIZE];          ///< cos, -sin pairs
+    static float window[SPECTRUM_SEG_SIZE];            ///< Hann window
+    static float window_power;                         ///< Sum of window^2
+    static bool tables_ready;                          ///< Tables computed?
+
+    static void make_tables (void);
+    static void fft (float* p_data);
+    void do_segment (void);
+
+public:
+    WindSpectrum (float rate);
+    void add_sample (float speed, float direction);
+    bool ready (void);
+    void report (TurbulenceReport& result);
+    void clear (void);
+};
+
+#endif // _WIND_SPECTRUM_H_
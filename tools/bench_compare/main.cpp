@@ -0,0 +1,190 @@
+/** @file main.cpp
+ *  This file contains a host program which compares two sets of results from
+ *  the station's benchmarks, such as those from two commits, and flags the
+ *  benchmarks which got slower.
+ *
+ *  Usage: bench_compare [-t threshold_percent] baseline.jsonl current.jsonl
+ *
+ *  Each file holds what the benchmark build printed on its serial port. Lines
+ *  which aren't benchmark results are ignored, so the output of a serial
+ *  monitor can be saved as it is. A benchmark is flagged as slower when its
+ *  best time is slower by more than the threshold (5% unless given) and also
+ *  by more than the spread of its runs, which is how much the mean time is
+ *  above the best, added up over both files; a change smaller than that is
+ *  noise, as either file's best time could be off by its own spread. The
+ *  exit status is 1 if any benchmark is flagged, so the program can be used
+ *  in a script.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unistd.h>
+
+
+/** @brief   The times of one benchmark, from the best run and the mean.
+ */
+struct Result
+{
+    double best;                        ///< Nanoseconds per operation, best run
+    double mean;                        ///< Nanoseconds per operation, mean
+
+    /// How far from the best run a run may be just by chance
+    double spread (void) const { return mean > best ? mean - best : 0.0; }
+};
+
+
+/** @brief   Find the text of a field's value in a line of flat JSON.
+ *  @param   line The line of JSON
+ *  @param   key The name of the field
+ *  @param   value Set to the value's text, without quotes
+ *  @return  True if the field was found
+ */
+static bool json_field (const std::string& line, const std::string& key,
+                        std::string& value)
+{
+    size_t pos = line.find ("\"" + key + "\":");
+    if (pos == std::string::npos)
+    {
+        return false;
+    }
+    pos += key.size () + 3;
+    if (pos < line.size () && line[pos] == '"')
+    {
+        size_t end = line.find ('"', ++pos);
+        value = line.substr (pos, end - pos);
+    }
+    else
+    {
+        value = line.substr (pos, line.find_first_of (",}", pos) - pos);
+    }
+    return true;
+}
+
+
+/** @brief   Read a results file into a map from benchmark name and size to
+ *           times per operation in nanoseconds. Results without a mean
+ *           time are taken to have no spread.
+ *  @return  True if the file could be read
+ */
+static bool read_results (const char* path,
+                          std::map<std::string, Result>& results)
+{
+    std::ifstream file (path);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string line, name, size, time, mean;
+    while (std::getline (file, line))
+    {
+        size_t start = line.find ("{\"bench\":");
+        if (start == std::string::npos)
+        {
+            continue;
+        }
+        line.erase (0, start);
+        if (json_field (line, "bench", name) && json_field (line, "size", size)
+            && json_field (line, "ns_per_op", time))
+        {
+            Result& result = results[name + "/" + size];
+            result.best = atof (time.c_str ());
+            result.mean = json_field (line, "mean_ns", mean)
+                          ? atof (mean.c_str ()) : result.best;
+        }
+    }
+    return true;
+}
+
+
+/** @brief   Run the comparison program.
+ */
+int main (int argc, char** argv)
+{
+    double threshold = 5.0;
+
+    int option;
+    while ((option = getopt (argc, argv, "t:")) != -1)
+    {
+        if (option == 't')
+        {
+            threshold = atof (optarg);
+        }
+        else
+        {
+            optind = argc + 1;
+        }
+    }
+    if (optind + 2 != argc)
+    {
+        fprintf (stderr, "Usage: %s [-t threshold_percent] baseline.jsonl "
+                 "current.jsonl\n", argv[0]);
+        return 2;
+    }
+
+    std::map<std::string, Result> baseline, current;
+    for (int index = 0; index < 2; index++)
+    {
+        const char* path = argv[optind + index];
+        if (!read_results (path, index ? current : baseline))
+        {
+            fprintf (stderr, "Can't read %s\n", path);
+            return 2;
+        }
+    }
+
+    int regressions = 0;
+    printf ("%-28s %14s %14s %12s %8s\n", "benchmark/size", "base ns",
+            "current ns", "noise ns", "change");
+    for (const auto& result : current)
+    {
+        const Result& now = result.second;
+        auto p_base = baseline.find (result.first);
+        if (p_base == baseline.end ())
+        {
+            printf ("%-28s %14s %14.3f %12.3f %8s  new\n",
+                    result.first.c_str (), "-", now.best, now.spread (), "-");
+            continue;
+        }
+
+        const Result& base = p_base->second;
+        double noise = base.spread () + now.spread ();
+        double difference = now.best - base.best;
+        double change = base.best > 0.0 ? 100.0 * difference / base.best : 0.0;
+        const char* note = "";
+        if (fabs (change) > threshold && fabs (difference) <= noise)
+        {
+            note = "  within noise";
+        }
+        else if (change > threshold)
+        {
+            note = "  REGRESSION";
+            regressions++;
+        }
+        else if (change < -threshold)
+        {
+            note = "  faster";
+        }
+        printf ("%-28s %14.3f %14.3f %12.3f %+7.1f%%%s\n",
+                result.first.c_str (), base.best, now.best, noise, change,
+                note);
+    }
+    for (const auto& result : baseline)
+    {
+        if (current.find (result.first) == current.end ())
+        {
+            printf ("%-28s %14.3f %14s %12.3f %8s  missing\n",
+                    result.first.c_str (), result.second.best, "-",
+                    result.second.spread (), "-");
+        }
+    }
+
+    printf ("%d of %zu benchmarks slower by more than %.1f%% and their noise\n",
+            regressions, current.size (), threshold);
+    return regressions ? 1 : 0;
+}
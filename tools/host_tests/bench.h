@@ -0,0 +1,133 @@
+/** @file bench.h
+ *  This file contains functions which time code on the host and print the
+ *  results as lines of JSON in the same form as the station's benchmark build,
+ *  so that @c tools/bench_compare can compare results from either.
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+
+/// Results are added here so the compiler can't optimize the work away
+extern volatile float bench_sink;
+
+/// The shortest timed run, in nanoseconds; shorter runs are mostly the noise
+/// of the clock and of whatever else the computer is doing
+const double BENCH_MIN_RUN_NS = 1.0e6;
+
+
+/** @brief   Print one benchmark's results as a line of JSON.
+ *  @param   name The name of the benchmark
+ *  @param   size The size of the data worked on, or 0 if there isn't one
+ *  @param   operations The number of operations in each timed run
+ *  @param   best The time of the fastest run in nanoseconds
+ *  @param   mean The mean time of all the runs in nanoseconds
+ */
+inline void print_bench (const char* name, uint32_t size, uint64_t operations,
+                         double best, double mean)
+{
+    printf ("{\"bench\":\"%s\",\"size\":%lu,\"iters\":%llu,"
+            "\"ns_per_op\":%.3f,\"mean_ns\":%.3f}\n", name,
+            (unsigned long)size, (unsigned long long)operations,
+            best / operations, mean / operations);
+    fflush (stdout);
+}
+
+
+/** @brief   Time some number of passes over a benchmark's iterations.
+ *  @return  The time taken in nanoseconds
+ */
+template <class Code>
+double time_passes (uint32_t iterations, uint32_t passes, Code& code)
+{
+    auto start = std::chrono::steady_clock::now ();
+    for (uint32_t pass = 0; pass < passes; pass++)
+    {
+        for (uint32_t count = 0; count < iterations; count++)
+        {
+            code (count);
+        }
+    }
+    return std::chrono::duration<double, std::nano> (
+        std::chrono::steady_clock::now () - start).count ();
+}
+
+
+/** @brief   Run some code many times and print how long it took.
+ *  @details One pass runs the code with each iteration number in turn. The
+ *           number of passes in a timed run is doubled until a run takes at
+ *           least @c BENCH_MIN_RUN_NS, which also warms up the caches; then
+ *           @c repeats runs are timed. @c ns_per_op is from the best run and
+ *           @c mean_ns from the average of all of them, so the difference
+ *           between them shows how much the timing varies.
+ *  @param   name The name of the benchmark
+ *  @param   size The size of the data being worked on, or 0 if there isn't one
+ *  @param   iterations The number of iterations in one pass
+ *  @param   code A function object which takes the iteration number
+ *  @param   repeats The number of timed runs
+ */
+template <class Code>
+void run_bench (const char* name, uint32_t size, uint32_t iterations,
+                Code code, uint8_t repeats = 7)
+{
+    uint32_t passes = 1;
+    while (time_passes (iterations, passes, code) < BENCH_MIN_RUN_NS
+           && passes < (1UL << 30) / iterations)
+    {
+        passes *= 2;
+    }
+
+    double best = 1.0e300;
+    double total = 0.0;
+    for (uint8_t repeat = 0; repeat < repeats; repeat++)
+    {
+        double elapsed = time_passes (iterations, passes, code);
+        best = elapsed < best ? elapsed : best;
+        total += elapsed;
+    }
+    print_bench (name, size, (uint64_t)iterations * passes, best,
+                 total / repeats);
+}
+
+
+/** @brief   Run some code a set number of times and print how long it took.
+ *  @details This is for code whose results are checked afterwards, so it
+ *           can't be run more times than asked for. The iterations are split
+ *           into @c slices timed separately, so the best and mean slices still
+ *           show how much the timing varies.
+ *  @param   name The name of the benchmark
+ *  @param   size The size of the data being worked on, or 0 if there isn't one
+ *  @param   iterations The number of times to run the code
+ *  @param   code A function object which takes the iteration number
+ *  @param   slices The number of parts into which the iterations are split
+ */
+template <class Code>
+void run_bench_once (const char* name, uint32_t size, uint32_t iterations,
+                     Code code, uint8_t slices = 5)
+{
+    uint32_t per_slice = iterations / slices;
+    double best = 1.0e300;
+    double total = 0.0;
+    for (uint8_t slice = 0; slice < slices; slice++)
+    {
+        uint32_t first = slice * per_slice;
+        uint32_t last = slice + 1 < slices ? first + per_slice : iterations;
+        auto start = std::chrono::steady_clock::now ();
+        for (uint32_t count = first; count < last; count++)
+        {
+            code (count);
+        }
+        double elapsed = std::chrono::duration<double, std::nano> (
+            std::chrono::steady_clock::now () - start).count ()
+            * per_slice / (last - first);
+        best = elapsed < best ? elapsed : best;
+        total += elapsed;
+    }
+    print_bench (name, size, per_slice, best, total / slices);
+}
+
+#endif // _BENCH_H_
@@ -0,0 +1,148 @@
+/** @file calibration_test.cpp
+ *  This file contains a host test of the compile-time calibration tables.
+ *  Every count of each table the station uses is checked against its sensor's
+ *  calibration worked out directly in double precision, in every unit. Vanes
+ *  with a mounting offset and a nonlinearity are checked too, including
+ *  offsets which push readings past north either way so that the result has
+ *  to be wrapped into one turn.
+ */
+
+#include <cmath>
+#include "calibration.h"
+#include "check.h"
+
+int check_failures = 0;
+
+
+/// A vane mounted 350 degrees off north with a wavy encoder error
+struct WavyVane
+{
+    static constexpr uint16_t counts_per_turn = 4096;
+    static constexpr double offset = 350.0;
+    static constexpr double error[17] = {0.0, 1.2, 2.0, 1.5, 0.3, -0.8, -1.9,
+                                         -2.4, -1.1, 0.2, 1.4, 2.6, 1.7, 0.4,
+                                         -0.6, -1.3, 0.0};
+};
+
+/// A vane mounted 20 degrees the other way, with a steady error
+struct BackwardVane
+{
+    static constexpr uint16_t counts_per_turn = 4096;
+    static constexpr double offset = -20.0;
+    static constexpr double error[17] = {0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5,
+                                         0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5,
+                                         0.5, 0.5, 0.5};
+};
+
+/// A small encoder, for a table whose segments are only 4 counts long
+struct SmallVane
+{
+    static constexpr uint16_t counts_per_turn = 64;
+    static constexpr double offset = 90.0;
+    static constexpr double error[17] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                                         0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                                         0.0, 0.0, 0.0};
+};
+
+
+/** @brief   Check every count of an anemometer table, and counts beyond it.
+ */
+template <class Sensor, class Units, uint32_t window_ms, uint16_t size>
+void check_anemometer (const char* name)
+{
+    typedef AnemometerCal<Sensor, Units, window_ms, size> Cal;
+    double worst = 0.0;
+
+    CHECK (Cal::convert (0) == 0.0f, "%s: calm reads %g", name,
+           Cal::convert (0));
+    for (uint16_t counts = 1; counts < size; counts++)
+    {
+        double hertz = counts * 1000.0 / window_ms;
+        double expected = 0.0;
+        for (int power = Sensor::poly_order; power >= 0; power--)
+        {
+            expected = expected * hertz + Sensor::poly[power];
+        }
+        expected *= Units::per_mps;
+        double error = fabs (Cal::convert (counts) - expected);
+        worst = fmax (worst, error / fmax (1.0, expected));
+    }
+    CHECK (worst < 1.0e-6, "%s: relative error %g", name, worst);
+    CHECK (Cal::convert (size) == Cal::convert (size - 1)
+           && Cal::convert (65535) == Cal::convert (size - 1),
+           "%s: counts past the table don't give its last value", name);
+    printf ("%-34s %5u counts, worst relative error %.2g\n", name, size,
+            worst);
+}
+
+
+/** @brief   Check every count of a vane table against the sensor's offset and
+ *           nonlinearity interpolated directly, and that counts wrap.
+ */
+template <class Sensor, class Units>
+void check_vane (const char* name)
+{
+    typedef VaneCal<Sensor, Units> Cal;
+    const uint16_t turn_counts = Sensor::counts_per_turn;
+    const double turn = 360.0 * Units::per_degree;
+    double worst = 0.0;
+    uint16_t out_of_range = 0, not_wrapped = 0;
+
+    for (uint32_t counts = 0; counts < turn_counts; counts++)
+    {
+        double position = counts * 16.0 / turn_counts;
+        uint8_t segment = (uint8_t)position;
+        double fraction = position - segment;
+        double error = Sensor::error[segment] * (1.0 - fraction)
+                       + Sensor::error[segment + 1] * fraction;
+        double expected = fmod (counts * 360.0 / turn_counts - error
+                                - Sensor::offset + 720.0, 360.0)
+                          * Units::per_degree;
+
+        float angle = Cal::convert (counts);
+        out_of_range += (angle < 0.0f || angle >= (float)turn) ? 1 : 0;
+        not_wrapped += (Cal::convert (counts + turn_counts) != angle) ? 1 : 0;
+
+        // Near north the two may sit on opposite sides of the wrap
+        double difference = fabs (angle - expected);
+        worst = fmax (worst, fmin (difference, turn - difference));
+    }
+    double tolerance = 1.0e-3 * Units::per_degree;
+    CHECK (worst < tolerance, "%s: error %g", name, worst);
+    CHECK (out_of_range == 0, "%s: %u angles outside one turn", name,
+           out_of_range);
+    CHECK (not_wrapped == 0, "%s: %u counts don't wrap at a turn", name,
+           not_wrapped);
+    printf ("%-34s %5u counts, worst error %.2g\n", name, turn_counts, worst);
+}
+
+
+/** @brief   Run the calibration tests.
+ */
+int main (void)
+{
+    // The tables used by the anemometer task, and the same in other units
+    check_anemometer<SecondWindC3, Mph, 64000, 4096> ("C3 rate table, mph");
+    check_anemometer<SecondWindC3, Mph, 10000, 1024> ("C3 10 s count, mph");
+    check_anemometer<SecondWindC3, MetersPerSec, 10000, 1024> (
+        "C3 10 s count, m/s");
+    check_anemometer<SecondWindC3, Knots, 500, 128> ("C3 0.5 s count, knots");
+
+    // The reference points from the C3's calibration sheet
+    typedef AnemometerCal<SecondWindC3, MetersPerSec, 1000, 128> PerSecond;
+    CHECK (fabs (PerSecond::convert (1) - 1.090) < 1.0e-3, "1 Hz is %g m/s",
+           PerSecond::convert (1));
+    CHECK (fabs (PerSecond::convert (10) - 7.984) < 1.0e-3, "10 Hz is %g m/s",
+           PerSecond::convert (10));
+
+    // The station's vane, then ones which are offset and nonlinear
+    check_vane<AS5600Vane, Degrees> ("AS5600 vane, degrees");
+    check_vane<WavyVane, Degrees> ("Wavy vane 350 deg off, degrees");
+    check_vane<WavyVane, Radians> ("Wavy vane 350 deg off, radians");
+    check_vane<BackwardVane, Degrees> ("Vane -20 deg off, degrees");
+    check_vane<SmallVane, Degrees> ("64 count vane, degrees");
+
+    printf (check_failures ? "%d checks failed\n" : "All checks passed\n",
+            check_failures);
+    return check_failures ? 1 : 0;
+}
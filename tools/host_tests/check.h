@@ -0,0 +1,29 @@
+/** @file check.h
+ *  This file contains a macro with which host tests check results.
+ */
+
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+#include <cstdio>
+
+/// Number of checks which have failed; a test's exit status
+extern int check_failures;
+
+
+/** @brief   Check that a condition holds, printing a message if it doesn't.
+ */
+#define CHECK(condition, ...)                                                 \
+    do                                                                        \
+    {                                                                         \
+        if (!(condition))                                                     \
+        {                                                                     \
+            printf ("FAILED %s:%d: %s: ", __FILE__, __LINE__, #condition);    \
+            printf (__VA_ARGS__);                                             \
+            printf ("\n");                                                    \
+            check_failures++;                                                 \
+        }                                                                     \
+    }                                                                         \
+    while (0)
+
+#endif // _CHECK_H_
@@ -0,0 +1,245 @@
+/** @file history_test.cpp
+ *  This file contains a host test of the history rings, including the search
+ *  by time across the wrap of @c millis(), and of the chunked CSV formatter
+ *  which the HTTP task serves them with. Simulated clients take turns getting
+ *  one chunk each while new records keep being added and old ones written
+ *  over, with chunk buffers of several sizes. Every chunk is parsed back and
+ *  checked, and the buffers are fenced to catch any write past their ends.
+ *  The whole server, with many clients at once, is tested in http_test.cpp.
+ */
+
+#include <cfloat>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "history.h"
+
+int check_failures = 0;
+
+const uint8_t Clients = 4;              ///< Clients served in turn
+const uint8_t Fence = 32;               ///< Guard bytes after each buffer
+
+
+/** @brief   One simulated client working through a response.
+ */
+struct Client
+{
+    uint8_t channel;                    ///< Channel being sent
+    uint32_t next;                      ///< Next record to be sent
+    uint32_t end;                       ///< Stop at this record
+    uint32_t last_time;                 ///< Time of the last row received
+    uint32_t rows;                      ///< Rows received
+    bool active;
+};
+
+
+/** @brief   Make a record whose values are all unusual in some way now and
+ *           then: the biggest floats, negatives and not-a-number.
+ */
+Conditions make_record (uint32_t time, std::mt19937& random)
+{
+    float value = std::uniform_real_distribution<float> (-50.0, 150.0) (random);
+    switch (random () % 8)
+    {
+        case 0: value = FLT_MAX; break;
+        case 1: value = -FLT_MAX; break;
+        case 2: value = NAN; break;
+        default: break;
+    }
+    return Conditions {value, value, value, value, value, time};
+}
+
+
+/** @brief   Parse one chunk and check its framing and rows.
+ *  @return  True if the chunk was well formed
+ */
+bool check_chunk (const char* p_chunk, size_t length, Client& client)
+{
+    std::string chunk (p_chunk, length);
+    size_t line_end = chunk.find ("\r\n");
+    if (line_end == std::string::npos)
+    {
+        return false;
+    }
+    size_t declared = strtoul (chunk.c_str (), NULL, 16);
+    if (line_end + 2 + declared + 2 != length
+        || chunk.compare (length - 2, 2, "\r\n") != 0)
+    {
+        return false;
+    }
+
+    std::string rows = chunk.substr (line_end + 2, declared);
+    for (size_t start = 0; start < rows.size (); )
+    {
+        size_t stop = rows.find ('\n', start);
+        if (stop == std::string::npos)
+        {
+            return false;
+        }
+        char* p_comma;
+        uint32_t time = strtoul (rows.c_str () + start, &p_comma, 10);
+        if (*p_comma != ',' || (client.rows && time <= client.last_time))
+        {
+            return false;
+        }
+        client.last_time = time;
+        client.rows++;
+        start = stop + 1;
+    }
+    return true;
+}
+
+
+/** @brief   Serve clients in turn from a history which keeps changing, with
+ *           a chunk buffer of the given size.
+ */
+void serve (size_t buffer_size, uint32_t seed)
+{
+    std::mt19937 random (seed);
+    History history (360);
+    uint32_t time = 0;
+    for (uint16_t count = 0; count < 500; count++)
+    {
+        history.add (make_record (time += 60000, random));
+    }
+
+    std::vector<char> buffer (buffer_size + Fence, '#');
+    Client clients[Clients];
+    for (Client& client : clients)
+    {
+        client.active = false;
+    }
+
+    uint32_t responses = 0, chunks = 0, bad_chunks = 0;
+    for (uint32_t turn = 0; turn < 20000; turn++)
+    {
+        // New records come in now and then, writing over old ones
+        if (random () % 5 == 0)
+        {
+            history.add (make_record (time += 60000, random));
+        }
+
+        Client& client = clients[turn % Clients];
+        if (!client.active)
+        {
+            client.channel = random () % 5;
+            uint32_t since = time - random () % (400 * 60000);
+            client.next = history.find_after (since);
+            client.end = history.end ();
+            client.rows = 0;
+            client.active = true;
+            responses++;
+            continue;
+        }
+
+        const char* p_start = NULL;
+        size_t length = make_chunk (history, client.channel, client.next,
+                                    client.end, buffer.data (), buffer_size,
+                                    &p_start);
+        if (length)
+        {
+            chunks++;
+            if (p_start < buffer.data ()
+                || p_start + length > buffer.data () + buffer_size
+                || !check_chunk (p_start, length, client))
+            {
+                bad_chunks++;
+            }
+        }
+        if (client.next >= client.end)
+        {
+            client.active = false;
+        }
+    }
+
+    bool fence_intact = true;
+    for (uint8_t index = 0; index < Fence; index++)
+    {
+        fence_intact &= buffer[buffer_size + index] == '#';
+    }
+    printf ("%zu byte chunks: %u responses, %u chunks, %u bad\n",
+            buffer_size, responses, chunks, bad_chunks);
+    CHECK (bad_chunks == 0, "%u bad chunks", bad_chunks);
+    CHECK (chunks > responses, "too few chunks");
+    CHECK (fence_intact, "write past the end of a %zu byte buffer",
+           buffer_size);
+}
+
+
+/** @brief   Check the ring's sequence numbers and the search by time.
+ */
+void test_ring (void)
+{
+    History history (10);
+    CHECK (history.first () == 0 && history.end () == 0, "not empty");
+    for (uint32_t count = 0; count < 25; count++)
+    {
+        history.add (Conditions {0.0, 0.0, 0.0, 0.0, 0.0, 1000 * count});
+    }
+    CHECK (history.first () == 15 && history.end () == 25, "holds %u to %u",
+           history.first (), history.end ());
+    CHECK (history.at (20).time == 20000, "record 20 has time %u",
+           history.at (20).time);
+    CHECK (history.find_after (20000) == 21, "after 20 s: %u",
+           history.find_after (20000));
+    CHECK (history.find_after (20500) == 21, "after 20.5 s: %u",
+           history.find_after (20500));
+    CHECK (history.find_after (0) == 15, "after 0: %u",
+           history.find_after (0));
+    CHECK (history.find_after (24000) == 25, "after the end: %u",
+           history.find_after (24000));
+
+    // A time later than any record comes from before a restart
+    CHECK (history.find_after (99000) == 15, "after a restart: %u",
+           history.find_after (99000));
+}
+
+
+/** @brief   Check the search by time across the wrap of @c millis().
+ */
+void test_wrap (void)
+{
+    History history (360);
+    const uint32_t start = 0xFFFFFFFF - 100 * 60000;
+    for (uint32_t count = 0; count < 500; count++)
+    {
+        history.add (Conditions {0.0, 0.0, 0.0, 0.0, 0.0,
+                                 start + count * 60000});
+    }
+
+    // A poller sending the time of each record it got gets the next one,
+    // whether that time was before the wrap or after it
+    for (uint32_t sequence = history.first (); sequence < history.end ();
+         sequence++)
+    {
+        uint32_t found = history.find_after (history.at (sequence).time);
+        CHECK (found == sequence + 1, "after record %u: %u", sequence, found);
+        found = history.find_after (history.at (sequence).time - 1);
+        CHECK (found == sequence, "just before record %u: %u", sequence,
+               found);
+    }
+    CHECK (history.find_after (start) == history.first (),
+           "after a time older than the history: %u",
+           history.find_after (start));
+}
+
+
+/** @brief   Run the history tests.
+ */
+int main (void)
+{
+    test_ring ();
+    test_wrap ();
+
+    // The HTTP task's own buffer size, then ones just big enough for a row
+    // of the biggest numbers, and ones too small for such a row
+    serve (20 * 24 + HISTORY_ROW_MAX, 1);
+    serve (HISTORY_ROW_MAX + 8, 2);
+    serve (100, 3);
+    serve (40, 4);
+
+    printf (check_failures ? "%d checks failed\n" : "All checks passed\n",
+            check_failures);
+    return check_failures ? 1 : 0;
+}
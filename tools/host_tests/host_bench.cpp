@@ -0,0 +1,74 @@
+/** @file host_bench.cpp
+ *  This file contains benchmarks of the station's portable processing code
+ *  which run on a host computer. Results are printed as JSON lines in the same
+ *  form as the station's benchmark build, so they can be saved and compared
+ *  with @c tools/bench_compare in the same way. Benchmarks which are also
+ *  in the station's build come from @c src/bench_cases.h, so they time the
+ *  same code under the same names.
+ */
+
+#include <random>
+#include "bench.h"
+#include "bench_cases.h"
+#include "wind_spectrum.h"
+
+volatile float bench_sink;
+
+
+/** @brief   Class which gives the benchmarks access to the FFT kernel.
+ */
+class SpectrumProbe : public WindSpectrum
+{
+public:
+    SpectrumProbe (void) : WindSpectrum (2.0) { }
+    using WindSpectrum::fft;
+};
+
+
+/** @brief   Time the portable FFT kernel and the whole spectrum analysis.
+ */
+void bench_spectrum (void)
+{
+    static SpectrumProbe probe;
+    static float data[2 * SPECTRUM_SEG_SIZE];
+    static float work[2 * SPECTRUM_SEG_SIZE];
+    std::mt19937 random (1);
+    std::uniform_real_distribution<float> uniform (-1.0, 1.0);
+    for (float& value : data)
+    {
+        value = uniform (random);
+    }
+
+    // The data is copied in each time so repeated transforms can't overflow
+    run_bench ("fft", SPECTRUM_SEG_SIZE, 10000, [&] (uint32_t count)
+    {
+        memcpy (work, data, sizeof (work));
+        probe.fft (work);
+        bench_sink = work[count & 63];
+    });
+
+    // One sample per operation; every SPECTRUM_HOP of them a segment is done
+    run_bench ("spectrum_add_sample", SPECTRUM_SEG_SIZE, 100000,
+               [&] (uint32_t count)
+    {
+        probe.add_sample (10.0 + data[count & 511], 180.0 + data[count & 255]);
+    });
+}
+
+
+/** @brief   Run all the host benchmarks.
+ */
+int main (void)
+{
+    printf ("{\"suite\":\"ESP32wind host\"}\n");
+    bench_spectrum ();
+    auto runner = [] (const char* name, uint32_t size, uint32_t iterations,
+                      auto code)
+    {
+        run_bench (name, size, iterations, code);
+    };
+    bench_sensors (runner);
+    bench_handoff (runner);
+    printf ("{\"done\":true}\n");
+    return 0;
+}
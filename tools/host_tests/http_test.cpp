@@ -0,0 +1,507 @@
+/** @file http_test.cpp
+ *  This file contains a host load test of the history server. The server's
+ *  own per-client code from @c http_history.h runs in one thread, as it does
+ *  in the HTTP task, with four client slots and histories which keep getting
+ *  new records. Several client threads connect to it at once through
+ *  in-memory connections and send it good requests, malformed, short and
+ *  oversized ones, requests which dribble in a few bytes at a time, and
+ *  clients which go away without finishing. Some connections take only part
+ *  of what's written to them, as a full TCP buffer does. Every response is
+ *  parsed back and checked: error responses must be whole, and a response
+ *  whose connection took a short write must stop where the write did.
+ */
+
+#include <atomic>
+#include <cstdarg>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "http_history.h"
+
+int check_failures = 0;
+
+const uint8_t Slots = 4;                ///< Clients the server looks after
+const uint8_t ClientThreads = 8;        ///< Threads making requests
+const uint16_t RequestsEach = 150;      ///< Requests made by each thread
+
+
+/** @brief   The two directions of one in-memory connection.
+ */
+struct Pipe
+{
+    std::mutex mutex;
+    std::string to_server;              ///< Bytes sent by the client
+    std::string to_client;              ///< Bytes sent by the server
+    bool client_gone = false;           ///< The client closed its end
+    bool server_gone = false;           ///< The server closed its end
+    size_t short_at = SIZE_MAX;         ///< Cut the write which passes this
+};
+
+
+/** @brief   The server's end of a connection, with the methods of a
+ *           @c WiFiClient which the server uses.
+ */
+class PipeClient
+{
+protected:
+    std::shared_ptr<Pipe> p_pipe;
+
+public:
+    PipeClient (void) { }
+    PipeClient (std::shared_ptr<Pipe> pipe) : p_pipe (pipe) { }
+
+    int available (void)
+    {
+        std::lock_guard<std::mutex> lock (p_pipe->mutex);
+        return p_pipe->to_server.size ();
+    }
+
+    int read (void)
+    {
+        std::lock_guard<std::mutex> lock (p_pipe->mutex);
+        if (p_pipe->to_server.empty ())
+        {
+            return -1;
+        }
+        uint8_t byte = p_pipe->to_server[0];
+        p_pipe->to_server.erase (0, 1);
+        return byte;
+    }
+
+    /** @brief   Take the bytes, except that the write which reaches
+     *           @c short_at is cut off there, as a TCP socket whose buffer is
+     *           nearly full does; later writes are taken whole again.
+     */
+    size_t write (const uint8_t* p_data, size_t length)
+    {
+        std::lock_guard<std::mutex> lock (p_pipe->mutex);
+        if (p_pipe->client_gone || p_pipe->server_gone)
+        {
+            return 0;
+        }
+        size_t taken = length;
+        size_t sent = p_pipe->to_client.size ();
+        if (sent + length > p_pipe->short_at)
+        {
+            taken = p_pipe->short_at - sent;
+            p_pipe->short_at = SIZE_MAX;
+        }
+        p_pipe->to_client.append ((const char*)p_data, taken);
+        return taken;
+    }
+
+    size_t print (const char* text)
+    {
+        return write ((const uint8_t*)text, strlen (text));
+    }
+
+    size_t printf (const char* format, ...)
+    {
+        char buffer[256];
+        va_list args;
+        va_start (args, format);
+        int length = vsnprintf (buffer, sizeof (buffer), format, args);
+        va_end (args);
+        return write ((const uint8_t*)buffer,
+                      std::min ((size_t)length, sizeof (buffer) - 1));
+    }
+
+    bool connected (void)
+    {
+        std::lock_guard<std::mutex> lock (p_pipe->mutex);
+        return !p_pipe->client_gone && !p_pipe->server_gone;
+    }
+
+    void stop (void)
+    {
+        std::lock_guard<std::mutex> lock (p_pipe->mutex);
+        p_pipe->server_gone = true;
+    }
+};
+
+
+/// Connections waiting for the server to take them, as in a listen queue
+std::mutex backlog_mutex;
+std::deque<std::shared_ptr<Pipe>> backlog;
+std::atomic<bool> clients_done (false);
+std::atomic<uint32_t> record_time (1000);   ///< Time of the newest record
+
+
+/** @brief   Run the server: add records now and then, take new connections
+ *           and give each client its turn, as the HTTP task does.
+ */
+void run_server (void)
+{
+    History fast (360);
+    History slow (288);
+    HttpSlot<PipeClient> slots[Slots];
+    for (HttpSlot<PipeClient>& slot : slots)
+    {
+        slot.active = false;
+    }
+
+    std::mt19937 random (7);
+    for (uint32_t turn = 0; ; turn++)
+    {
+        uint32_t now = millis ();
+        if (turn % 3 == 0)
+        {
+            uint32_t time = record_time += 1;
+            float value = std::uniform_real_distribution<float> (-50.0, 150.0)
+                          (random);
+            fast.add (Conditions {value, value, value, value, value, time});
+            if (turn % 30 == 0)
+            {
+                slow.add (Conditions {value, value, value, value, value,
+                                      time});
+            }
+        }
+
+        bool busy = false;
+        for (HttpSlot<PipeClient>& slot : slots)
+        {
+            if (!slot.active)
+            {
+                std::lock_guard<std::mutex> lock (backlog_mutex);
+                if (!backlog.empty ())
+                {
+                    slot.open (PipeClient (backlog.front ()), now);
+                    backlog.pop_front ();
+                }
+                break;
+            }
+        }
+        for (HttpSlot<PipeClient>& slot : slots)
+        {
+            if (slot.active)
+            {
+                busy = true;
+                CHECK (slot.length < sizeof (slot.request), "request length %u",
+                       slot.length);
+                serve_slot (slot, fast, slow, now);
+            }
+        }
+
+        if (!busy && clients_done)
+        {
+            std::lock_guard<std::mutex> lock (backlog_mutex);
+            if (backlog.empty ())
+            {
+                return;
+            }
+        }
+        if (!busy)
+        {
+            std::this_thread::yield ();
+        }
+    }
+}
+
+
+/** @brief   Check a chunked CSV body; it may stop early only if it's cut
+ *           off at the end of the data, as after a short write.
+ *  @param   body The body after the headers
+ *  @param   since Every row's time must be later than this, allowing for
+ *           times which wrap around
+ *  @param   may_be_cut True if the connection took a short write
+ *  @return  An empty string if the body is right, or what's wrong with it
+ */
+std::string check_body (const std::string& body, uint32_t since,
+                        bool may_be_cut)
+{
+    size_t pos = 0;
+    uint32_t last_time = since;
+    for (;;)
+    {
+        size_t line_end = body.find ("\r\n", pos);
+        if (line_end == std::string::npos)
+        {
+            return may_be_cut ? "" : "chunk size line cut off";
+        }
+        char* p_end;
+        size_t declared = strtoul (body.c_str () + pos, &p_end, 16);
+        if (p_end != body.c_str () + line_end || p_end == body.c_str () + pos)
+        {
+            return "bad chunk size line";
+        }
+        pos = line_end + 2;
+        if (declared == 0)
+        {
+            return body.compare (pos, std::string::npos, "\r\n") == 0
+                   ? "" : "bad ending";
+        }
+        if (body.size () < pos + declared + 2)
+        {
+            return may_be_cut ? "" : "chunk cut off";
+        }
+        if (body.compare (pos + declared, 2, "\r\n") != 0)
+        {
+            return "chunk is not the size it says";
+        }
+
+        std::string rows = body.substr (pos, declared);
+        for (size_t start = 0; start < rows.size (); )
+        {
+            size_t stop = rows.find ('\n', start);
+            char* p_comma;
+            uint32_t time = strtoul (rows.c_str () + start, &p_comma, 10);
+            if (stop == std::string::npos || *p_comma != ','
+                || (int32_t)(time - last_time) <= 0)
+            {
+                return "bad row";
+            }
+            last_time = time;
+            start = stop + 1;
+        }
+        pos += declared + 2;
+    }
+}
+
+
+/** @brief   The kinds of request a client thread makes.
+ */
+enum RequestKind {GOOD, GOOD_SLOW_WRITER, GOOD_SHORT_WRITE, BAD_QUERY,
+                  NOT_FOUND, OVERSIZED, GARBAGE, ABANDONED, KINDS};
+
+
+/** @brief   Make requests of the server one after another and check the
+ *           responses.
+ */
+void run_client (uint8_t number)
+{
+    std::mt19937 random (100 + number);
+    const char* bad_queries[] = {
+        "GET /history HTTP/1.1\r\n",
+        "GET /history?channel=nope HTTP/1.1\r\n",
+        "GET /history?channel=gust&res=5m HTTP/1.1\r\n",
+        "GET /history?channel=gust&since=12x HTTP/1.1\r\n",
+        "GET /history?channel=gust&since= HTTP/1.1\r\n",
+        "GET /history?channel=wind_speed_and_a_very_long_name HTTP/1.1\r\n",
+        "GET /history\r\nX: ?channel=gust\r\n"};
+    const char* not_found[] = {
+        "\r\n", "G\r\n", "GET\r\n", "GET \r\n", "POST /history HTTP/1.1\r\n",
+        "GET /historyx?channel=gust HTTP/1.1\r\n", "GET / HTTP/1.1\r\n"};
+
+    for (uint16_t count = 0; count < RequestsEach; count++)
+    {
+        RequestKind kind = (RequestKind)(random () % KINDS);
+        uint32_t since = 0;
+        std::string request;
+        switch (kind)
+        {
+            case BAD_QUERY:
+                request = bad_queries[random () % 7];
+                break;
+            case NOT_FOUND:
+                request = not_found[random () % 7];
+                break;
+            case OVERSIZED:
+                request = "GET /history?channel=gust&x="
+                          + std::string (200 + random () % 200, 'a')
+                          + " HTTP/1.1\r\n";
+                break;
+            case GARBAGE:
+                for (uint16_t index = random () % 100; index > 0; index--)
+                {
+                    request += (char)(1 + random () % 255);
+                }
+                request += "\r\n";
+                break;
+            case ABANDONED:
+                request = "GET /hist";
+                break;
+            default:
+                since = record_time - random () % 2000;
+                request = "GET /history?channel="
+                          + std::string (history_channels[random () % 5])
+                          + (random () % 4 ? "" : "&res=10m")
+                          + (random () % 2 ? "&since=" + std::to_string (since)
+                                           : "")
+                          + " HTTP/1.1\r\nHost: station\r\n\r\n";
+                if (request.find ("since") == std::string::npos)
+                {
+                    since = 0;
+                }
+                break;
+        }
+
+        auto p_pipe = std::make_shared<Pipe> ();
+        if (kind == GOOD_SHORT_WRITE)
+        {
+            p_pipe->short_at = 100 + random () % 1500;
+        }
+        {
+            std::lock_guard<std::mutex> lock (backlog_mutex);
+            backlog.push_back (p_pipe);
+        }
+
+        // Send the request all at once, or a few bytes at a time
+        size_t step = kind == GOOD_SLOW_WRITER ? 1 + random () % 7
+                                               : request.size ();
+        for (size_t start = 0; start < request.size (); start += step)
+        {
+            std::lock_guard<std::mutex> lock (p_pipe->mutex);
+            p_pipe->to_server += request.substr (start, step);
+            if (step < request.size ())
+            {
+                std::this_thread::yield ();
+            }
+        }
+        if (kind == ABANDONED)
+        {
+            std::lock_guard<std::mutex> lock (p_pipe->mutex);
+            p_pipe->client_gone = true;
+        }
+
+        // Wait for the server to finish with this connection
+        for (uint32_t waited = 0; ; waited++)
+        {
+            {
+                std::lock_guard<std::mutex> lock (p_pipe->mutex);
+                if (p_pipe->server_gone)
+                {
+                    break;
+                }
+            }
+            if (waited > 200000)
+            {
+                CHECK (false, "client %u request %u (kind %d) never finished",
+                       number, count, kind);
+                return;
+            }
+            std::this_thread::sleep_for (std::chrono::microseconds (50));
+        }
+
+        std::string response = p_pipe->to_client;
+        size_t header_end = response.find ("\r\n\r\n");
+        std::string status = response.substr (0, response.find ("\r\n"));
+        std::string body = header_end == std::string::npos
+                           ? "" : response.substr (header_end + 4);
+        switch (kind)
+        {
+            case ABANDONED:
+                CHECK (response.empty (), "abandoned request got '%s'",
+                       status.c_str ());
+                break;
+            case BAD_QUERY:
+            case NOT_FOUND:
+            case OVERSIZED:
+            case GARBAGE:
+            {
+                const char* expected = kind == BAD_QUERY ? "400"
+                                       : kind == OVERSIZED ? "414" : "404";
+                CHECK (status.compare (0, 12, std::string ("HTTP/1.1 ")
+                                       + expected) == 0,
+                       "kind %d request '%s' got '%s'", kind,
+                       request.substr (0, 40).c_str (), status.c_str ());
+                size_t length_at = response.find ("Content-Length: ");
+                CHECK (length_at != std::string::npos
+                       && strtoul (response.c_str () + length_at + 16, NULL,
+                                   10) == body.size (),
+                       "error body is not its declared length");
+                break;
+            }
+            default:
+                if (kind == GOOD_SHORT_WRITE && header_end == std::string::npos)
+                {
+                    break;              // Cut off in the headers
+                }
+                CHECK (status == "HTTP/1.1 200 OK", "good request '%s' got "
+                       "'%s'", request.substr (0, 60).c_str (),
+                       status.c_str ());
+                std::string problem = check_body (body, since,
+                                                  kind == GOOD_SHORT_WRITE);
+                CHECK (problem.empty (), "response to '%s': %s",
+                       request.substr (0, 60).c_str (), problem.c_str ());
+                break;
+        }
+    }
+}
+
+
+/** @brief   Check the request parser on its own with requests at the edges.
+ */
+void test_parser (void)
+{
+    struct Case
+    {
+        const char* request;
+        uint16_t status;
+        uint8_t channel;
+        bool slow;
+        bool has_since;
+        uint32_t since;
+    };
+    const Case cases[] = {
+        {"GET /history?channel=gust HTTP/1.1\r\n", 200, 2, false, false, 0},
+        {"GET /history?channel=humidity&res=10m&since=4294967295 HTTP/1.0\r\n",
+         200, 4, true, true, 4294967295},
+        {"GET /history?since=5&res=1m&channel=wind_dir\r\n", 200, 1, false,
+         true, 5},
+        {"GET /history?channel=gust", 200, 2, false, false, 0},
+        {"GET /history?channel=gust&since=99999999999999999 HTTP/1.1\r\n",
+         400, 0, false, false, 0},
+        {"GET /history?channel=gust&since=4294967296 HTTP/1.1\r\n", 400, 0,
+         false, false, 0},
+        {"GET /history?channel=gust&since=-1 HTTP/1.1\r\n", 400, 0, false,
+         false, 0},
+        {"GET /history?channel=gust&res=1minute_and_more HTTP/1.1\r\n", 400,
+         0, false, false, 0},
+        {"GET /history?channel= HTTP/1.1\r\n", 400, 0, false, false, 0},
+        {"GET /history? HTTP/1.1\r\n", 400, 0, false, false, 0},
+        {"GET /history?res=1m\r\nX: &channel=gust\r\n", 400, 0, false, false,
+         0},
+        {"", 404, 0, false, false, 0},
+        {"GET", 404, 0, false, false, 0},
+        {" ", 404, 0, false, false, 0},
+        {"GET /histor", 404, 0, false, false, 0},
+        {"GET /history/x?channel=gust HTTP/1.1\r\n", 404, 0, false, false, 0}};
+
+    for (const Case& test : cases)
+    {
+        char request[HTTP_REQUEST_MAX];
+        snprintf (request, sizeof (request), "%s", test.request);
+        HistoryQuery query;
+        uint16_t status = parse_history_request (request, query);
+        CHECK (status == test.status, "'%s' gave %u, not %u", test.request,
+               status, test.status);
+        if (status == 200 && test.status == 200)
+        {
+            CHECK (query.channel == test.channel && query.slow == test.slow
+                   && query.has_since == test.has_since
+                   && (!test.has_since || query.since == test.since),
+                   "'%s' parsed wrong", test.request);
+        }
+    }
+}
+
+
+/** @brief   Run the parser test, then the server with many clients at once.
+ */
+int main (void)
+{
+    test_parser ();
+
+    std::thread server (run_server);
+    std::vector<std::thread> clients;
+    for (uint8_t number = 0; number < ClientThreads; number++)
+    {
+        clients.emplace_back (run_client, number);
+    }
+    for (std::thread& client : clients)
+    {
+        client.join ();
+    }
+    clients_done = true;
+    server.join ();
+
+    printf ("%u clients made %u requests each\n", ClientThreads, RequestsEach);
+    printf (check_failures ? "%d checks failed\n" : "All checks passed\n",
+            check_failures);
+    return check_failures ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+/** @file publisher_bench.cpp
+ *  This file contains a host benchmark and test of the publisher with one of
+ *  its sinks deliberately stalled, as an MQTT sink is while its broker is
+ *  down. It times each publish and checks that the healthy sink still gets
+ *  every message while the stalled sink keeps just the messages its drop
+ *  policy says to keep, delivering them in order once it's ready again.
+ *  Timings are printed as JSON lines like the other benchmarks.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "check.h"
+#include "publisher.h"
+
+int check_failures = 0;
+volatile float bench_sink;
+
+const uint32_t Messages = 2000;         ///< Messages published in each test
+const uint8_t StalledQueue = 8;         ///< Queue size of the stalled sink
+
+
+/** @brief   Sink which records the numbers of the messages delivered to it
+ *           and which can be stalled and released.
+ */
+class RecordingSink : public PublishSink
+{
+protected:
+    std::mutex mutex;
+    std::vector<uint32_t> received;
+
+    bool deliver (const Payload& payload)
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        received.push_back (strtoul (payload.text, NULL, 10));
+        return true;
+    }
+
+    bool ready (void)
+    {
+        return !stalled;
+    }
+
+    /// Notes the drops, as the broker's sink does for the network health
+    void service (void)
+    {
+        drops_seen = dropped ();
+    }
+
+public:
+    std::atomic<bool> stalled;
+    std::atomic<uint32_t> drops_seen;   ///< Drops seen by @c service()
+
+    RecordingSink (uint8_t queue_size, DropPolicy drop_policy,
+                   TickType_t block_time = 0)
+        : PublishSink (queue_size, drop_policy, block_time, 5), stalled (false),
+          drops_seen (0)
+    {
+    }
+
+    /** @brief   Wait until a number of messages have come in, or give up.
+     *  @return  A copy of the numbers of the messages received
+     */
+    std::vector<uint32_t> wait_for (size_t count, uint32_t timeout_ms = 5000)
+    {
+        for (uint32_t waited = 0; waited < timeout_ms; waited += 5)
+        {
+            {
+                std::lock_guard<std::mutex> lock (mutex);
+                if (received.size () >= count)
+                {
+                    break;
+                }
+            }
+            vTaskDelay (5);
+        }
+        vTaskDelay (50);                    // Catch any extras
+        std::lock_guard<std::mutex> lock (mutex);
+        return received;
+    }
+};
+
+
+/** @brief   Check that a list of message numbers runs from one number to
+ *           another in order.
+ */
+bool in_order (const std::vector<uint32_t>& numbers, uint32_t first,
+               uint32_t last)
+{
+    if (numbers.size () != last - first + 1)
+    {
+        return false;
+    }
+    for (size_t index = 0; index < numbers.size (); index++)
+    {
+        if (numbers[index] != first + index)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** @brief   Publish to a healthy sink and a stalled one with a given policy,
+ *           then release the stalled one and see what it kept.
+ *  @details Sinks are made with @c new and never deleted, as they are on the
+ *           station, because their tasks run until the program ends.
+ */
+void test_stalled (const char* name, DropPolicy policy, TickType_t block_time)
+{
+    RecordingSink* p_healthy = new RecordingSink (64, BLOCK, portMAX_DELAY);
+    RecordingSink* p_stalled = new RecordingSink (StalledQueue, policy,
+                                                  block_time);
+    p_stalled->stalled = true;
+
+    Publisher publisher;
+    publisher.add_sink (*p_healthy);
+    publisher.add_sink (*p_stalled);
+    xTaskCreate (PublishSink::task, "Healthy", 4096, p_healthy, 2, NULL);
+    xTaskCreate (PublishSink::task, "Stalled", 4096, p_stalled, 2, NULL);
+
+    // Exactly Messages are published, so what each sink got can be checked
+    run_bench_once (name, 2, Messages, [&] (uint32_t count)
+    {
+        publisher.publish ("bench/stalled", std::to_string (count).c_str ());
+    });
+
+    std::vector<uint32_t> healthy = p_healthy->wait_for (Messages);
+    CHECK (in_order (healthy, 0, Messages - 1),
+           "%s: healthy sink got %zu messages", name, healthy.size ());
+    CHECK (p_healthy->dropped () == 0, "%s: healthy sink dropped %u", name,
+           p_healthy->dropped ());
+    CHECK (p_stalled->dropped () == Messages - StalledQueue,
+           "%s: stalled sink dropped %u", name, p_stalled->dropped ());
+
+    // The stalled sink's task still gets to see its drops
+    vTaskDelay (50);
+    CHECK (p_stalled->drops_seen == Messages - StalledQueue,
+           "%s: stalled sink's service saw %u drops", name,
+           (unsigned)p_stalled->drops_seen);
+
+    // Dropping the oldest keeps the latest messages; the others keep the first
+    p_stalled->stalled = false;
+    std::vector<uint32_t> kept = p_stalled->wait_for (StalledQueue);
+    uint32_t first = (policy == DROP_OLDEST) ? Messages - StalledQueue : 0;
+    CHECK (in_order (kept, first, first + StalledQueue - 1),
+           "%s: stalled sink delivered %zu messages starting with %u", name,
+           kept.size (), kept.empty () ? 0 : kept[0]);
+}
+
+
+/** @brief   Time publishing to healthy sinks only, for comparison.
+ */
+void bench_healthy (void)
+{
+    Publisher publisher;
+    for (uint8_t index = 0; index < 3; index++)
+    {
+        RecordingSink* p_sink = new RecordingSink (64, BLOCK, portMAX_DELAY);
+        publisher.add_sink (*p_sink);
+        xTaskCreate (PublishSink::task, "Healthy", 4096, p_sink, 2, NULL);
+    }
+    run_bench ("publish_healthy", 3, Messages, [&] (uint32_t count)
+    {
+        publisher.publish ("bench/healthy", std::to_string (count).c_str ());
+    });
+}
+
+
+/** @brief   Run the stalled sink tests and benchmarks.
+ */
+int main (void)
+{
+    bench_healthy ();
+    test_stalled ("publish_stalled_drop_oldest", DROP_OLDEST, 0);
+    test_stalled ("publish_stalled_drop_newest", DROP_NEWEST, 0);
+    test_stalled ("publish_stalled_block", BLOCK, 1);
+
+    printf (check_failures ? "%d checks failed\n" : "All checks passed\n",
+            check_failures);
+    return check_failures ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+/** @file seqlock_test.cpp
+ *  This file contains a host test of the sequence lock which shares the
+ *  current conditions. Several writer threads each fill every field of the
+ *  record with one number while several reader threads copy the record as
+ *  fast as they can; a torn copy would hold numbers from two writes.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "shares.h"
+
+int check_failures = 0;
+
+const uint8_t Writers = 3;              ///< Threads writing the record
+const uint8_t Readers = 4;              ///< Threads reading the record
+const uint32_t RunTime = 2000;          ///< Length of the test (ms)
+
+
+/** @brief   Check that every field of a record holds the same number.
+ */
+bool consistent (const Conditions& record)
+{
+    float value = record.time;
+    return record.wind_speed == value && record.wind_dir == value
+           && record.gust == value && record.temperature == value
+           && record.humidity == value;
+}
+
+
+/** @brief   Run the sequence lock test.
+ */
+int main (void)
+{
+    SeqLock<Conditions> lock (Conditions {0.0, 0.0, 0.0, 0.0, 0.0, 0});
+    std::atomic<bool> running (true);
+    std::atomic<uint64_t> reads (0), torn (0), writes (0);
+    std::vector<std::thread> threads;
+
+    // Each writer uses numbers of its own which fit exactly in a float, and
+    // writes some records whole and some a field at a time with update()
+    for (uint8_t writer = 0; writer < Writers; writer++)
+    {
+        threads.emplace_back ([&, writer]
+        {
+            for (uint32_t count = 0; running; count++)
+            {
+                uint32_t number = (count % 1000000) * Writers + writer;
+                float value = number;
+                if (count & 1)
+                {
+                    lock.put (Conditions {value, value, value, value, value,
+                                          number});
+                }
+                else
+                {
+                    lock.update ([value, number] (Conditions& now)
+                    {
+                        now.wind_speed = value;
+                        now.wind_dir = value;
+                        now.gust = value;
+                        now.temperature = value;
+                        now.humidity = value;
+                        now.time = number;
+                    });
+                }
+                writes++;
+            }
+        });
+    }
+
+    for (uint8_t reader = 0; reader < Readers; reader++)
+    {
+        threads.emplace_back ([&]
+        {
+            uint64_t my_reads = 0, my_torn = 0;
+            while (running)
+            {
+                Conditions copy = lock.get ();
+                my_torn += consistent (copy) ? 0 : 1;
+                my_reads++;
+            }
+            reads += my_reads;
+            torn += my_torn;
+        });
+    }
+
+    std::this_thread::sleep_for (std::chrono::milliseconds (RunTime));
+    running = false;
+    for (std::thread& thread : threads)
+    {
+        thread.join ();
+    }
+
+    printf ("%llu writes, %llu reads, %llu torn\n",
+            (unsigned long long)writes, (unsigned long long)reads,
+            (unsigned long long)torn);
+    CHECK (torn == 0, "%llu torn reads", (unsigned long long)torn);
+    CHECK (reads > 0 && writes > 0, "threads didn't run");
+
+    printf (check_failures ? "%d checks failed\n" : "All checks passed\n",
+            check_failures);
+    return check_failures ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+/** @file Arduino.h
+ *  This file stands in for the Arduino core when station code is built on a
+ *  host computer for testing. Only what the tested files use is here.
+ */
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "freertos.h"
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+
+#define PI 3.1415926535897932384626433832795
+
+uint32_t millis (void);
+uint32_t micros (void);
+void delay (uint32_t ms);
+
+#endif // _HOST_ARDUINO_H_
@@ -0,0 +1,12 @@
+/** @file Wire.h
+ *  This file stands in for the Arduino I2C library on a host computer. There
+ *  is no I2C port on the host, so drivers are run against @c MockI2C instead;
+ *  @c TwoWire is here only so the drivers' default port type can be named.
+ */
+
+#ifndef _HOST_WIRE_H_
+#define _HOST_WIRE_H_
+
+class TwoWire;
+
+#endif // _HOST_WIRE_H_
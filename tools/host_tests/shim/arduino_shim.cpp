@@ -0,0 +1,38 @@
+/** @file arduino_shim.cpp
+ *  This file contains host versions of the Arduino timing functions.
+ */
+
+#include <chrono>
+#include <thread>
+#include "Arduino.h"
+
+
+/// The time at which the program started, which stands in for boot time
+static const std::chrono::steady_clock::time_point boot_time
+    = std::chrono::steady_clock::now ();
+
+
+/** @brief   Get the time in milliseconds since the program started.
+ */
+uint32_t millis (void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds> (
+        std::chrono::steady_clock::now () - boot_time).count ();
+}
+
+
+/** @brief   Get the time in microseconds since the program started.
+ */
+uint32_t micros (void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds> (
+        std::chrono::steady_clock::now () - boot_time).count ();
+}
+
+
+/** @brief   Wait for a number of milliseconds.
+ */
+void delay (uint32_t ms)
+{
+    std::this_thread::sleep_for (std::chrono::milliseconds (ms));
+}
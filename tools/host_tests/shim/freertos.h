@@ -0,0 +1,59 @@
+/** @file freertos.h
+ *  This file stands in for the parts of FreeRTOS which station code uses, so
+ *  that it can be run on a host computer. Tasks are threads, a tick is one
+ *  millisecond as on the ESP32, queues are guarded by a mutex, and spinlocks
+ *  are mutexes.
+ */
+
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+#include <cstdint>
+#include <mutex>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void (*TaskFunction_t) (void*);
+typedef void* TaskHandle_t;
+typedef struct HostQueue* QueueHandle_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define portMAX_DELAY 0xFFFFFFFFUL
+
+
+/** @brief   A spinlock, which on the host is a mutex.
+ *  @details Copying or assigning one makes a new unlocked lock, as assigning
+ *           @c portMUX_INITIALIZER_UNLOCKED does on the ESP32.
+ */
+struct portMUX_TYPE
+{
+    std::mutex mutex;
+
+    portMUX_TYPE (void) { }
+    portMUX_TYPE (const portMUX_TYPE&) { }
+    portMUX_TYPE& operator= (const portMUX_TYPE&) { return *this; }
+};
+
+#define portMUX_INITIALIZER_UNLOCKED portMUX_TYPE ()
+#define portENTER_CRITICAL(p_mux) (p_mux)->mutex.lock ()
+#define portEXIT_CRITICAL(p_mux) (p_mux)->mutex.unlock ()
+#define portENTER_CRITICAL_ISR(p_mux) (p_mux)->mutex.lock ()
+#define portEXIT_CRITICAL_ISR(p_mux) (p_mux)->mutex.unlock ()
+
+QueueHandle_t xQueueCreate (UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSendToBack (QueueHandle_t queue, const void* p_item,
+                             TickType_t wait);
+BaseType_t xQueueReceive (QueueHandle_t queue, void* p_item, TickType_t wait);
+BaseType_t xQueuePeek (QueueHandle_t queue, void* p_item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting (QueueHandle_t queue);
+
+BaseType_t xTaskCreate (TaskFunction_t function, const char* name,
+                        uint32_t stack_size, void* p_params,
+                        UBaseType_t priority, TaskHandle_t* p_handle);
+void vTaskDelay (TickType_t ticks);
+TickType_t xTaskGetTickCount (void);
+
+#endif // _HOST_FREERTOS_H_
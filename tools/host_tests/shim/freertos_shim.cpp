@@ -0,0 +1,142 @@
+/** @file freertos_shim.cpp
+ *  This file contains host versions of the FreeRTOS queue and task functions
+ *  which station code uses.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+#include "freertos.h"
+
+
+/** @brief   A FreeRTOS queue: a bounded queue of fixed size items.
+ */
+struct HostQueue
+{
+    std::mutex mutex;
+    std::condition_variable changed;        ///< Signaled on every put or get
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+};
+
+
+/** @brief   Wait on a queue until a condition holds or the ticks run out.
+ *  @return  True if the condition holds
+ */
+template <class Condition>
+static bool wait_for (HostQueue* queue, std::unique_lock<std::mutex>& lock,
+                      TickType_t wait, Condition condition)
+{
+    if (wait == 0)
+    {
+        return condition ();
+    }
+    if (wait == portMAX_DELAY)
+    {
+        queue->changed.wait (lock, condition);
+        return true;
+    }
+    return queue->changed.wait_for (lock, std::chrono::milliseconds (wait),
+                                    condition);
+}
+
+
+QueueHandle_t xQueueCreate (UBaseType_t length, UBaseType_t item_size)
+{
+    HostQueue* queue = new HostQueue;
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+
+BaseType_t xQueueSendToBack (QueueHandle_t queue, const void* p_item,
+                             TickType_t wait)
+{
+    std::unique_lock<std::mutex> lock (queue->mutex);
+    if (!wait_for (queue, lock, wait,
+                   [queue] { return queue->items.size () < queue->length; }))
+    {
+        return pdFALSE;
+    }
+    const uint8_t* p_bytes = (const uint8_t*)p_item;
+    queue->items.emplace_back (p_bytes, p_bytes + queue->item_size);
+    queue->changed.notify_all ();
+    return pdTRUE;
+}
+
+
+/** @brief   Copy out the item at the front of a queue, removing it or not.
+ */
+static BaseType_t take (QueueHandle_t queue, void* p_item, TickType_t wait,
+                        bool remove)
+{
+    std::unique_lock<std::mutex> lock (queue->mutex);
+    if (!wait_for (queue, lock, wait,
+                   [queue] { return !queue->items.empty (); }))
+    {
+        return pdFALSE;
+    }
+    memcpy (p_item, queue->items.front ().data (), queue->item_size);
+    if (remove)
+    {
+        queue->items.pop_front ();
+        queue->changed.notify_all ();
+    }
+    return pdTRUE;
+}
+
+
+BaseType_t xQueueReceive (QueueHandle_t queue, void* p_item, TickType_t wait)
+{
+    return take (queue, p_item, wait, true);
+}
+
+
+BaseType_t xQueuePeek (QueueHandle_t queue, void* p_item, TickType_t wait)
+{
+    return take (queue, p_item, wait, false);
+}
+
+
+UBaseType_t uxQueueMessagesWaiting (QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> lock (queue->mutex);
+    return queue->items.size ();
+}
+
+
+/** @brief   Start a task, which on the host is a detached thread; the stack
+ *           size and priority are ignored.
+ */
+BaseType_t xTaskCreate (TaskFunction_t function, const char* name,
+                        uint32_t stack_size, void* p_params,
+                        UBaseType_t priority, TaskHandle_t* p_handle)
+{
+    (void)name;
+    (void)stack_size;
+    (void)priority;
+    std::thread (function, p_params).detach ();
+    if (p_handle)
+    {
+        *p_handle = NULL;
+    }
+    return pdPASS;
+}
+
+
+void vTaskDelay (TickType_t ticks)
+{
+    std::this_thread::sleep_for (std::chrono::milliseconds (ticks));
+}
+
+
+TickType_t xTaskGetTickCount (void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds> (
+        std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
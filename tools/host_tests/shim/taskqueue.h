@@ -0,0 +1,46 @@
+/** @file taskqueue.h
+ *  This file stands in for the ME507 @c Queue template on a host computer.
+ *  Only the functions which station code uses are here.
+ */
+
+#ifndef _HOST_TASKQUEUE_H_
+#define _HOST_TASKQUEUE_H_
+
+#include "freertos.h"
+
+
+/** @brief   A queue of items passed between tasks.
+ */
+template <class DataType>
+class Queue
+{
+protected:
+    QueueHandle_t handle;
+    TickType_t ticks_to_wait;           ///< How long @c put() waits for room
+
+public:
+    Queue (BaseType_t queue_size, const char* p_name = NULL,
+           TickType_t wait_time = portMAX_DELAY)
+    {
+        (void)p_name;
+        handle = xQueueCreate (queue_size, sizeof (DataType));
+        ticks_to_wait = wait_time;
+    }
+
+    void put (const DataType& item)
+    {
+        xQueueSendToBack (handle, &item, ticks_to_wait);
+    }
+
+    void get (DataType& recv_item)
+    {
+        xQueueReceive (handle, &recv_item, portMAX_DELAY);
+    }
+
+    bool any (void)
+    {
+        return uxQueueMessagesWaiting (handle) > 0;
+    }
+};
+
+#endif // _HOST_TASKQUEUE_H_
@@ -0,0 +1,46 @@
+/** @file taskshare.h
+ *  This file stands in for the ME507 @c Share template on a host computer.
+ *  Only the functions which station code uses are here.
+ */
+
+#ifndef _HOST_TASKSHARE_H_
+#define _HOST_TASKSHARE_H_
+
+#include "freertos.h"
+
+
+/** @brief   A variable shared between tasks, guarded by a lock.
+ */
+template <class DataType>
+class Share
+{
+protected:
+    DataType value;
+    portMUX_TYPE mux;
+
+public:
+    Share (const char* p_name = NULL) { (void)p_name; }
+
+    void put (const DataType& new_value)
+    {
+        portENTER_CRITICAL (&mux);
+        value = new_value;
+        portEXIT_CRITICAL (&mux);
+    }
+
+    void get (DataType& recv_value)
+    {
+        portENTER_CRITICAL (&mux);
+        recv_value = value;
+        portEXIT_CRITICAL (&mux);
+    }
+
+    DataType get (void)
+    {
+        DataType copy;
+        get (copy);
+        return copy;
+    }
+};
+
+#endif // _HOST_TASKSHARE_H_
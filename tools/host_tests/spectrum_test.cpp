@@ -0,0 +1,177 @@
+/** @file spectrum_test.cpp
+ *  This file contains a host test of the wind spectrum analyzer. On boards
+ *  which have ESP-DSP the portable FFT kernel is never run, so this is the
+ *  only place where it's checked. The test checks the kernel against a plain
+ *  discrete Fourier transform, checks that the spectra integrate to the
+ *  variance of the input, and checks that a sinusoid lands in the right
+ *  octave band. The gust meter which it shares with the anemometer task is
+ *  checked here too.
+ */
+
+#include <cmath>
+#include <random>
+#include "check.h"
+#include "wind_spectrum.h"
+
+int check_failures = 0;
+
+
+/** @brief   Class which gives the test access to the FFT kernel.
+ */
+class SpectrumProbe : public WindSpectrum
+{
+public:
+    SpectrumProbe (void) : WindSpectrum (2.0) { }
+    using WindSpectrum::fft;
+};
+
+
+/** @brief   Check the FFT kernel against a DFT of random complex data.
+ */
+void test_fft (void)
+{
+    const uint16_t N = SPECTRUM_SEG_SIZE;
+    SpectrumProbe probe;
+    std::mt19937 random (1);
+    std::uniform_real_distribution<float> uniform (-1.0, 1.0);
+
+    static float data[2 * N];
+    static double input[2 * N];
+    for (uint16_t index = 0; index < 2 * N; index++)
+    {
+        input[index] = data[index] = uniform (random);
+    }
+    probe.fft (data);
+
+    double worst = 0.0;
+    for (uint16_t k = 0; k < N; k++)
+    {
+        double re = 0.0, im = 0.0;
+        for (uint16_t n = 0; n < N; n++)
+        {
+            double phase = -2.0 * M_PI * k * n / N;
+            re += input[2 * n] * cos (phase) - input[2 * n + 1] * sin (phase);
+            im += input[2 * n] * sin (phase) + input[2 * n + 1] * cos (phase);
+        }
+        worst = fmax (worst, fabs (re - data[2 * k]));
+        worst = fmax (worst, fabs (im - data[2 * k + 1]));
+    }
+    printf ("FFT vs DFT: largest error %.2g\n", worst);
+    CHECK (worst < 1.0e-4, "FFT differs from DFT by %g", worst);
+}
+
+
+/** @brief   Add up a report's band densities times their bandwidths.
+ */
+double integrate (const float* bands, float sample_rate)
+{
+    double total = 0.0;
+    double bin_width = sample_rate / SPECTRUM_SEG_SIZE;
+    for (uint8_t band = 0; band < SPECTRUM_BANDS; band++)
+    {
+        uint16_t bins = (band == SPECTRUM_BANDS - 1) ? (1 << band) + 1
+                                                     : (1 << band);
+        total += bands[band] * bins * bin_width;
+    }
+    return total;
+}
+
+
+/** @brief   Check that the spectra integrate to the variance of the input.
+ *  @details The wind blows from a steady direction with noisy speed, so the
+ *           along-wind spectrum should hold the speed's variance and the
+ *           cross-wind spectrum should hold almost nothing; then the wind
+ *           swings from side to side at a steady speed, which should move the
+ *           variance into the cross-wind spectrum.
+ */
+void test_variance (void)
+{
+    std::mt19937 random (2);
+    std::normal_distribution<float> noise (0.0, 1.5);
+    WindSpectrum spectrum (2.0);
+    TurbulenceReport report;
+
+    for (uint16_t count = 0; count < 4096; count++)
+    {
+        spectrum.add_sample (12.0 + noise (random), 270.0);
+    }
+    spectrum.report (report);
+    double along = integrate (report.along, report.sample_rate);
+    double cross = integrate (report.cross, report.sample_rate);
+    double variance = pow (report.turb_intensity * report.mean_speed, 2);
+    printf ("Steady direction: variance %.3f, along %.3f, cross %.3g, "
+            "%u segments\n", variance, along, cross, report.n_segments);
+    CHECK (fabs (along / variance - 1.0) < 0.1, "along %g vs variance %g",
+           along, variance);
+    CHECK (cross < 1.0e-3 * variance, "cross %g should be near zero", cross);
+    CHECK (report.n_segments == 4096 / SPECTRUM_HOP - 1, "%u segments",
+           report.n_segments);
+
+    // Side to side swings of about 10 mph at 0.25 Hz at a steady speed
+    spectrum.clear ();
+    for (uint16_t count = 0; count < 4096; count++)
+    {
+        float swing = 40.0 * sin (2.0 * M_PI * 0.25 * count / 2.0);
+        spectrum.add_sample (15.0, 90.0 + swing);
+    }
+    spectrum.report (report);
+    cross = integrate (report.cross, report.sample_rate);
+    double expected = 0.0;
+    for (uint16_t count = 0; count < 4096; count++)
+    {
+        double swing = 40.0 * M_PI / 180.0
+                       * sin (2.0 * M_PI * 0.25 * count / 2.0);
+        expected += pow (15.0 * sin (swing), 2) / 4096;
+    }
+    printf ("Swinging direction: cross variance %.3f, expected %.3f\n", cross,
+            expected);
+    CHECK (fabs (cross / expected - 1.0) < 0.1, "cross %g vs %g", cross,
+           expected);
+
+    // 0.25 Hz is bin 32 at 2 Hz sampling, the first bin of band 5
+    uint8_t biggest = 0;
+    for (uint8_t band = 1; band < SPECTRUM_BANDS; band++)
+    {
+        biggest = report.cross[band] > report.cross[biggest] ? band : biggest;
+    }
+    CHECK (biggest == 5, "swing landed in band %u", biggest);
+}
+
+
+/** @brief   Check that gusts are the highest 3 second average speed, and
+ *           that a gust can span the start of a new period.
+ */
+void test_gusts (void)
+{
+    GustMeter gusts;
+    for (uint8_t count = 0; count < GUST_SAMPLES - 1; count++)
+    {
+        gusts.add (30.0);
+    }
+    CHECK (gusts.highest () == 0.0, "gust %g before the ring filled",
+           gusts.highest ());
+
+    gusts.add (30.0);
+    gusts.add (6.0);
+    CHECK (gusts.highest () == 30.0, "gust %g, not 30", gusts.highest ());
+
+    gusts.clear ();
+    gusts.add (6.0);
+    float expected = (30.0 * (GUST_SAMPLES - 2) + 6.0 + 6.0) / GUST_SAMPLES;
+    CHECK (fabs (gusts.highest () - expected) < 1.0e-4,
+           "gust %g across a clear, not %g", gusts.highest (), expected);
+}
+
+
+/** @brief   Run the spectrum tests.
+ */
+int main (void)
+{
+    test_fft ();
+    test_variance ();
+    test_gusts ();
+
+    printf (check_failures ? "%d checks failed\n" : "All checks passed\n",
+            check_failures);
+    return check_failures ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+/** @file vane_test.cpp
+ *  This file contains a host test of the wind vane's code: reading the AS5600
+ *  through its driver, with a stand-in I2C port answering for the sensor, and
+ *  averaging directions on both sides of north.
+ */
+
+#include <cmath>
+#include "check.h"
+#include "AS5600.h"
+#include "mock_i2c.h"
+#include "angle_average.h"
+
+int check_failures = 0;
+
+
+/** @brief   Check that the driver reads the registers it should.
+ */
+void test_as5600 (void)
+{
+    MockI2C bus (0x36);
+    AS5600 sensor (bus, 0x36, 0);
+
+    for (uint16_t angle = 0; angle < 4096; angle += 13)
+    {
+        bus.registers[0x0E] = angle >> 8;
+        bus.registers[0x0F] = angle & 0xFF;
+        CHECK (sensor.getAngle () == angle, "Angle %u read as %u", angle,
+               sensor.getAngle ());
+    }
+
+    bus.registers[0x0C] = 0x0F;
+    bus.registers[0x0D] = 0xED;
+    CHECK (sensor.getPosition () == 0x0FED, "Raw angle read as 0x%X",
+           sensor.getPosition ());
+    bus.registers[0x1A] = 0x80;
+    CHECK (sensor.getGain () == 0x80, "Gain read as 0x%X", sensor.getGain ());
+    bus.registers[0x0B] = 0xFF;
+    CHECK (sensor.getStatus () == 0x38, "Status read as 0x%X",
+           sensor.getStatus ());
+
+    // A sensor at another address doesn't answer
+    AS5600 missing (bus, 0x40, 0);
+    CHECK (missing.getAngle () == 0xFFFF, "Missing sensor gave %u",
+           missing.getAngle ());
+}
+
+
+/** @brief   Find how far apart two directions are, the short way round.
+ */
+float separation (float first, float second)
+{
+    float difference = fmod (fabs (first - second), 360.0);
+    return difference > 180.0 ? 360.0 - difference : difference;
+}
+
+
+/** @brief   Check directions averaged as vectors, including across north.
+ */
+void test_average (void)
+{
+    const float cases[][3] = {{90.0, 180.0, 135.0}, {350.0, 10.0, 0.0},
+                              {340.0, 0.0, 350.0}, {5.0, 15.0, 10.0},
+                              {270.0, 200.0, 235.0}};
+    AngleAverage angles;
+
+    for (const float* p_case : cases)
+    {
+        angles.clear ();
+        for (uint8_t count = 0; count < 10; count++)
+        {
+            angles.add (p_case[0]);
+            angles.add (p_case[1]);
+        }
+        float average = angles.average ();
+        CHECK (separation (average, p_case[2]) < 0.01,
+               "Average of %g and %g is %g, not %g", p_case[0], p_case[1],
+               average, p_case[2]);
+        CHECK (average >= 0.0 && average <= 360.0, "Average %g is outside "
+               "one turn", average);
+    }
+}
+
+
+/** @brief   Run the vane tests.
+ */
+int main (void)
+{
+    test_as5600 ();
+    test_average ();
+
+    printf (check_failures ? "%d checks failed\n" : "All checks passed\n",
+            check_failures);
+    return check_failures ? 1 : 0;
+}
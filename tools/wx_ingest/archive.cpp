@@ -0,0 +1,113 @@
+/** @file archive.cpp
+ *  This file contains a class which keeps every channel's column file and
+ *  draws its plot, with a limit on how many files are open at once.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <sys/stat.h>
+#include "archive.h"
+#include "svg_plot.h"
+
+
+/** @brief   Make a directory if it isn't there already.
+ */
+bool make_dir (const std::string& path)
+{
+    return mkdir (path.c_str (), 0755) == 0 || errno == EEXIST;
+}
+
+
+/** @brief   Create an archive which keeps its files in the given directories.
+ *  @param   data The directory for column files
+ *  @param   plots The directory for SVG plots
+ *  @param   max_open_files The most column files to keep open at once
+ */
+Archive::Archive (const std::string& data, const std::string& plots,
+                  size_t max_open_files)
+    : data_dir (data), plot_dir (plots),
+      max_open (max_open_files ? max_open_files : 1)
+{
+}
+
+
+/** @brief   Get a channel's column file, opening it if it's closed and
+ *           closing the least recently used one if too many are open.
+ *  @param   station The station, which names the channel's directory
+ *  @param   key The station and channel, as @c station/channel
+ *  @return  The open column file, or @c nullptr if it can't be opened
+ */
+ColumnFile* Archive::column (const std::string& station,
+                             const std::string& key)
+{
+    Channel& channel = columns[key];
+    if (channel.p_file)
+    {
+        open_keys.splice (open_keys.begin (), open_keys, channel.recent);
+        return channel.p_file.get ();
+    }
+
+    if (open_keys.size () >= max_open)
+    {
+        columns[open_keys.back ()].p_file.reset ();
+        open_keys.pop_back ();
+    }
+
+    make_dir (data_dir + "/" + station);
+    std::unique_ptr<ColumnFile> p_file (new ColumnFile);
+    if (!p_file->open (data_dir + "/" + key + ".col"))
+    {
+        fprintf (stderr, "Can't open column file for %s\n", key.c_str ());
+        return nullptr;
+    }
+    channel.p_file = std::move (p_file);
+    open_keys.push_front (key);
+    channel.recent = open_keys.begin ();
+    return channel.p_file.get ();
+}
+
+
+/** @brief   Store a sample, opening its channel's file if need be.
+ */
+void Archive::store (const Sample& sample)
+{
+    std::string key = sample.station + "/" + sample.channel;
+    ColumnFile* p_column = column (sample.station, key);
+    if (p_column && p_column->append (sample.t, sample.value))
+    {
+        dirty.insert (key);
+    }
+}
+
+
+/** @brief   Find the time of the newest sample stored for a channel.
+ *  @return  The time, or a very negative number if nothing is stored
+ */
+double Archive::last_time (const std::string& station,
+                           const std::string& channel)
+{
+    ColumnFile* p_column = column (station, station + "/" + channel);
+    return p_column ? p_column->last_time () : -1.0e300;
+}
+
+
+/** @brief   Redraw the plots of all channels which have new data.
+ *  @return  The number of plots redrawn
+ */
+size_t Archive::render (void)
+{
+    size_t drawn = 0;
+    for (const std::string& key : dirty)
+    {
+        std::string station = key.substr (0, key.find ('/'));
+        ColumnFile* p_column = column (station, key);
+        make_dir (plot_dir + "/" + station);
+        if (p_column && write_svg_plot (*p_column, key,
+                                         plot_dir + "/" + key + ".svg"))
+        {
+            drawn++;
+        }
+    }
+    dirty.clear ();
+    return drawn;
+}
@@ -0,0 +1,60 @@
+/** @file archive.h
+ *  This file contains a class which keeps every channel's column file and
+ *  draws its plot, with a limit on how many files are open at once.
+ */
+
+#ifndef _ARCHIVE_H_
+#define _ARCHIVE_H_
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include "column_file.h"
+#include "decode.h"
+
+
+bool make_dir (const std::string& path);
+
+
+/** @brief   Class which owns every channel's column file and its plot.
+ *  @details Files are opened the first time a channel's data arrives. Each
+ *           channel which gets new data is marked dirty, and only dirty
+ *           channels are redrawn when @c render() is called. Each open file
+ *           holds a file descriptor and a mapping, so with many stations only
+ *           the most recently used @c max_open files are kept open; the
+ *           others are closed and opened again when they're next needed.
+ */
+class Archive
+{
+protected:
+    /// A channel's column file and its place in the list of recent use
+    struct Channel
+    {
+        std::unique_ptr<ColumnFile> p_file;
+        std::list<std::string>::iterator recent;
+    };
+
+    std::string data_dir;                 ///< Where column files are kept
+    std::string plot_dir;                 ///< Where SVG plots are written
+    size_t max_open;                      ///< Most files kept open at once
+    std::map<std::string, Channel> columns;
+    std::list<std::string> open_keys;     ///< Open channels, newest first
+    std::set<std::string> dirty;          ///< Channels with new data
+
+    ColumnFile* column (const std::string& station, const std::string& key);
+
+public:
+    Archive (const std::string& data, const std::string& plots,
+             size_t max_open_files = 256);
+
+    void store (const Sample& sample);
+    double last_time (const std::string& station, const std::string& channel);
+    size_t render (void);
+
+    /// Number of column files open now
+    size_t open_files (void) const { return open_keys.size (); }
+};
+
+#endif // _ARCHIVE_H_
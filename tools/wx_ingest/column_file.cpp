@@ -0,0 +1,177 @@
+/** @file column_file.cpp
+ *  This file contains a class which keeps one channel's time series in a
+ *  memory-mapped file with the times and values stored as separate columns.
+ */
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "column_file.h"
+
+
+/// Identifies the file format and version
+static const char MAGIC[8] = {'W', 'X', 'C', 'O', 'L', '0', '0', '1'};
+
+/// Number of samples for which room is made in a new file
+static const uint64_t FIRST_CAPACITY = 1024;
+
+
+/** @brief   Create a column file object which has no file open yet.
+ */
+ColumnFile::ColumnFile () : fd (-1), p_map (nullptr), map_size (0)
+{
+    static_assert (sizeof (Header) == 64, "Column file header must be 64 B");
+}
+
+
+/** @brief   Destroy the object, unmapping and closing its file.
+ */
+ColumnFile::~ColumnFile ()
+{
+    close ();
+}
+
+
+/** @brief   Open a column file, creating it if it doesn't exist.
+ *  @param   path The name of the file
+ *  @return  True if the file is open and in the right format
+ */
+bool ColumnFile::open (const std::string& path)
+{
+    close ();
+    fd = ::open (path.c_str (), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat (fd, &info) != 0)
+    {
+        close ();
+        return false;
+    }
+
+    // A new file gets a header and room for some samples
+    if (info.st_size == 0)
+    {
+        Header fresh = {};
+        memcpy (fresh.magic, MAGIC, sizeof (MAGIC));
+        if (pwrite (fd, &fresh, sizeof (fresh), 0) != sizeof (fresh)
+            || !remap (FIRST_CAPACITY))
+        {
+            close ();
+            return false;
+        }
+        return true;
+    }
+
+    Header existing;
+    if (pread (fd, &existing, sizeof (existing), 0) != sizeof (existing)
+        || memcmp (existing.magic, MAGIC, sizeof (MAGIC)) != 0
+        || existing.count > existing.capacity
+        || (uint64_t)info.st_size < sizeof (Header) + existing.capacity * 12)
+    {
+        close ();
+        return false;
+    }
+    map_size = info.st_size;
+    p_map = (uint8_t*)mmap (nullptr, map_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+    if (p_map == MAP_FAILED)
+    {
+        p_map = nullptr;
+        close ();
+        return false;
+    }
+    return true;
+}
+
+
+/** @brief   Grow the file to hold the given number of samples and map it.
+ *  @details The value column starts right after the time column, so when the
+ *           capacity grows the values already stored are moved up to the
+ *           column's new starting place.
+ *  @param   capacity The number of samples the file should have room for
+ *  @return  True if it worked
+ */
+bool ColumnFile::remap (uint64_t capacity)
+{
+    uint64_t old_capacity = p_map ? header ()->capacity : 0;
+    uint64_t count = p_map ? header ()->count : 0;
+    size_t new_size = sizeof (Header) + capacity * (sizeof (double)
+                                                    + sizeof (float));
+
+    if (ftruncate (fd, new_size) != 0)
+    {
+        return false;
+    }
+    if (p_map)
+    {
+        munmap (p_map, map_size);
+    }
+    map_size = new_size;
+    p_map = (uint8_t*)mmap (nullptr, map_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+    if (p_map == MAP_FAILED)
+    {
+        p_map = nullptr;
+        return false;
+    }
+
+    uint8_t* p_old_values = p_map + sizeof (Header)
+                            + old_capacity * sizeof (double);
+    uint8_t* p_new_values = p_map + sizeof (Header)
+                            + capacity * sizeof (double);
+    if (count)
+    {
+        memmove (p_new_values, p_old_values, count * sizeof (float));
+    }
+    header ()->capacity = capacity;
+    return true;
+}
+
+
+/** @brief   Add one sample to the end of the file.
+ *  @param   t The time of the sample
+ *  @param   value The measured value
+ *  @return  True if the sample was stored
+ */
+bool ColumnFile::append (double t, float value)
+{
+    if (!p_map)
+    {
+        return false;
+    }
+
+    uint64_t count = header ()->count;
+    if (count >= header ()->capacity && !remap (2 * header ()->capacity))
+    {
+        return false;
+    }
+
+    ((double*)(p_map + sizeof (Header)))[count] = t;
+    ((float*)(p_map + sizeof (Header)
+              + header ()->capacity * sizeof (double)))[count] = value;
+    __atomic_store_n (&header ()->count, count + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+
+/** @brief   Unmap and close the file, if one is open.
+ */
+void ColumnFile::close (void)
+{
+    if (p_map)
+    {
+        munmap (p_map, map_size);
+        p_map = nullptr;
+    }
+    if (fd >= 0)
+    {
+        ::close (fd);
+        fd = -1;
+    }
+}
@@ -0,0 +1,74 @@
+/** @file column_file.h
+ *  This file contains a class which keeps one channel's time series in a
+ *  memory-mapped file with the times and values stored as separate columns.
+ */
+
+#ifndef _COLUMN_FILE_H_
+#define _COLUMN_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/** @brief   Class which appends samples to a memory-mapped columnar file.
+ *  @details The file begins with a 64 byte header holding a magic string,
+ *           the number of samples stored and the number there is room for.
+ *           Then come the times as @c double values and then the values as
+ *           @c float values, each in one contiguous column so that a reader
+ *           (or a plot) can scan either one without touching the other. When
+ *           the file fills up its capacity is doubled and the value column is
+ *           moved to its new place. The sample count is written after the
+ *           sample itself, so a crash never leaves a half-written sample
+ *           counted.
+ */
+class ColumnFile
+{
+protected:
+    int fd;                             ///< The open file
+    uint8_t* p_map;                     ///< Where the file is mapped
+    size_t map_size;                    ///< Bytes mapped
+
+    struct Header
+    {
+        char magic[8];                  ///< Identifies the file format
+        uint64_t count;                 ///< Number of samples stored
+        uint64_t capacity;              ///< Number of samples there's room for
+        uint8_t unused[40];             ///< Pads the header to 64 bytes
+    };
+
+    Header* header (void) const { return (Header*)p_map; }
+    bool remap (uint64_t capacity);
+
+public:
+    ColumnFile ();
+    ~ColumnFile ();
+
+    bool open (const std::string& path);
+    void close (void);
+    bool append (double t, float value);
+
+    /// Number of samples in the file
+    size_t size (void) const { return p_map ? header ()->count : 0; }
+
+    /// The time of the most recent sample, or a very negative number if none
+    double last_time (void) const
+    {
+        return size () ? times ()[size () - 1] : -1.0e300;
+    }
+
+    /// The column of sample times
+    const double* times (void) const
+    {
+        return (const double*)(p_map + sizeof (Header));
+    }
+
+    /// The column of sample values
+    const float* values (void) const
+    {
+        return (const float*)(p_map + sizeof (Header)
+                              + header ()->capacity * sizeof (double));
+    }
+};
+
+#endif // _COLUMN_FILE_H_
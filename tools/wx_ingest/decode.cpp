@@ -0,0 +1,361 @@
+/** @file decode.cpp
+ *  This file contains functions which turn the weather station's MQTT
+ *  messages into time-stamped samples, one per channel.
+ */
+
+#include <cctype>
+#include <cstdlib>
+#include <memory>
+#include "decode.h"
+
+
+/** @brief   A parsed JSON value; just enough JSON for the station's messages.
+ */
+struct JsonValue
+{
+    enum Kind { NONE, NUMBER, STRING, ARRAY, OBJECT } kind = NONE;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> items;                  ///< Array elements
+    std::vector<std::pair<std::string, JsonValue>> members;  ///< Object
+
+    /** @brief   Find an object member by name, or @c nullptr if it's absent.
+     */
+    const JsonValue* find (const std::string& name) const
+    {
+        for (const auto& member : members)
+        {
+            if (member.first == name)
+            {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+
+/** @brief   Class which parses a JSON document from a string.
+ *  @details Parsing failures leave a value of kind @c NONE; string escapes
+ *           other than a backslash-escaped character are not translated.
+ */
+class JsonParser
+{
+protected:
+    const std::string& text;
+    size_t pos;
+
+    void skip_space (void)
+    {
+        while (pos < text.size () && isspace ((unsigned char)text[pos]))
+        {
+            pos++;
+        }
+    }
+
+    bool parse_string (std::string& out)
+    {
+        if (pos >= text.size () || text[pos] != '"')
+        {
+            return false;
+        }
+        for (pos++; pos < text.size () && text[pos] != '"'; pos++)
+        {
+            if (text[pos] == '\\' && pos + 1 < text.size ())
+            {
+                pos++;
+            }
+            out += text[pos];
+        }
+        return pos++ < text.size ();
+    }
+
+public:
+    JsonParser (const std::string& source) : text (source), pos (0) { }
+
+    /** @brief   Parse one value and whatever it holds.
+     *  @param   value The value to be filled in
+     *  @param   depth How many arrays and objects the value is inside
+     *  @return  True if the value was parsed and isn't nested too deeply
+     */
+    bool parse (JsonValue& value, unsigned depth = 0)
+    {
+        skip_space ();
+        if (pos >= text.size () || depth > JSON_MAX_DEPTH)
+        {
+            return false;
+        }
+
+        char first = text[pos];
+        if (first == '{' || first == '[')
+        {
+            bool is_object = first == '{';
+            char last = is_object ? '}' : ']';
+            value.kind = is_object ? JsonValue::OBJECT : JsonValue::ARRAY;
+            pos++;
+            for (;;)
+            {
+                skip_space ();
+                if (pos < text.size () && text[pos] == last)
+                {
+                    pos++;
+                    return true;
+                }
+                std::string key;
+                if (is_object)
+                {
+                    skip_space ();
+                    if (!parse_string (key))
+                    {
+                        return false;
+                    }
+                    skip_space ();
+                    if (pos >= text.size () || text[pos++] != ':')
+                    {
+                        return false;
+                    }
+                }
+                JsonValue item;
+                if (!parse (item, depth + 1))
+                {
+                    return false;
+                }
+                if (is_object)
+                {
+                    value.members.emplace_back (key, std::move (item));
+                }
+                else
+                {
+                    value.items.push_back (std::move (item));
+                }
+                skip_space ();
+                if (pos < text.size () && text[pos] == ',')
+                {
+                    pos++;
+                }
+            }
+        }
+        else if (first == '"')
+        {
+            value.kind = JsonValue::STRING;
+            return parse_string (value.text);
+        }
+        else
+        {
+            const char* p_start = text.c_str () + pos;
+            char* p_end = nullptr;
+            value.number = strtod (p_start, &p_end);
+            if (p_end == p_start)
+            {
+                return false;
+            }
+            value.kind = JsonValue::NUMBER;
+            pos += p_end - p_start;
+            return true;
+        }
+    }
+};
+
+
+/** @brief   Set the names of the fields in comma-separated messages.
+ *  @param   topic_suffix The end of the topics to which the names apply,
+ *           such as @c "weather/test"
+ *  @param   names The names of the fields, in order
+ */
+void Decoder::set_fields (const std::string& topic_suffix,
+                          const std::vector<std::string>& names)
+{
+    csv_fields[topic_suffix] = names;
+}
+
+
+/** @brief   Set the function which finds the last time stored for a channel.
+ *  @param   lookup A function which takes the station and the channel and
+ *           returns the time of the newest sample stored for them
+ */
+void Decoder::set_last_time (std::function<double (const std::string&,
+                                                   const std::string&)> lookup)
+{
+    last_time = lookup;
+}
+
+
+/** @brief   Check that a station name is safe to use as a directory name.
+ */
+static bool good_station (const std::string& station)
+{
+    if (station.empty () || station == "." || station == "..")
+    {
+        return false;
+    }
+    for (char letter : station)
+    {
+        if (!isprint ((unsigned char)letter))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** @brief   Make a channel name safe to use as a file name.
+ */
+static std::string safe_channel (std::string channel)
+{
+    for (char& letter : channel)
+    {
+        if (letter == '/' || !isprint ((unsigned char)letter))
+        {
+            letter = '_';
+        }
+    }
+    return channel;
+}
+
+
+/** @brief   Decode one MQTT message into samples.
+ *  @param   topic The topic on which the message arrived
+ *  @param   payload The message itself
+ *  @param   received The time at which it arrived, in seconds since 1970
+ *  @param   out A vector to which any samples found are appended
+ */
+void Decoder::decode (const std::string& topic, const std::string& payload,
+                      double received, std::vector<Sample>& out)
+{
+    // The station is the first level of the topic; the rest names channels
+    size_t slash = topic.find ('/');
+    std::string station = topic.substr (0, slash);
+    if (!good_station (station))
+    {
+        return;
+    }
+    std::string base = slash == std::string::npos ? "data"
+                                                  : topic.substr (slash + 1);
+    for (char& letter : base)
+    {
+        letter = letter == '/' ? '.' : letter;
+    }
+
+    size_t start = payload.find_first_not_of (" \t\r\n");
+    if (start == std::string::npos)
+    {
+        return;
+    }
+
+    // NodeRedPlot messages and flat JSON objects
+    if (payload[start] == '[' || payload[start] == '{')
+    {
+        JsonValue root;
+        JsonParser parser (payload);
+        if (!parser.parse (root))
+        {
+            return;
+        }
+
+        if (root.kind == JsonValue::ARRAY && !root.items.empty ()
+            && root.items[0].kind == JsonValue::OBJECT)
+        {
+            const JsonValue* p_series = root.items[0].find ("series");
+            const JsonValue* p_data = root.items[0].find ("data");
+            if (!p_series || !p_data)
+            {
+                return;
+            }
+            for (size_t curve = 0; curve < p_series->items.size ()
+                 && curve < p_data->items.size (); curve++)
+            {
+                std::string channel = safe_channel (
+                    base + "." + p_series->items[curve].text);
+                const std::vector<JsonValue>& points
+                    = p_data->items[curve].items;
+
+                // After a restart, skip the points which were stored before
+                std::string key = station + "/" + channel;
+                auto p_seen = plot_seen.find (key);
+                if (p_seen == plot_seen.end ())
+                {
+                    size_t stored = 0;
+                    double last = last_time ? last_time (station, channel)
+                                            : -1.0e300;
+                    while (stored < points.size ()
+                           && points[stored].find ("x")
+                           && points[stored].find ("x")->number <= last)
+                    {
+                        stored++;
+                    }
+                    p_seen = plot_seen.emplace (key, stored).first;
+                }
+                size_t& seen = p_seen->second;
+                if (points.size () < seen)
+                {
+                    seen = 0;
+                }
+                for ( ; seen < points.size (); seen++)
+                {
+                    const JsonValue* p_x = points[seen].find ("x");
+                    const JsonValue* p_y = points[seen].find ("y");
+                    if (p_x && p_y)
+                    {
+                        out.push_back ({station, channel, p_x->number,
+                                        (float)p_y->number});
+                    }
+                }
+            }
+        }
+        else if (root.kind == JsonValue::OBJECT)
+        {
+            for (const auto& member : root.members)
+            {
+                std::string channel = safe_channel (base + "." + member.first);
+                if (member.second.kind == JsonValue::NUMBER)
+                {
+                    out.push_back ({station, channel, received,
+                                    (float)member.second.number});
+                }
+                for (size_t index = 0; index < member.second.items.size ();
+                     index++)
+                {
+                    out.push_back ({station,
+                                    channel + "_" + std::to_string (index),
+                                    received,
+                                    (float)member.second.items[index].number});
+                }
+            }
+        }
+        return;
+    }
+
+    // Otherwise look for comma-separated numbers
+    const std::vector<std::string>* p_names = nullptr;
+    for (const auto& entry : csv_fields)
+    {
+        if (topic.size () >= entry.first.size ()
+            && topic.compare (topic.size () - entry.first.size (),
+                              entry.first.size (), entry.first) == 0)
+        {
+            p_names = &entry.second;
+        }
+    }
+
+    const char* p_next = payload.c_str () + start;
+    for (size_t field = 0; *p_next; field++)
+    {
+        char* p_end = nullptr;
+        double number = strtod (p_next, &p_end);
+        if (p_end == p_next)
+        {
+            return;
+        }
+        std::string name = (p_names && field < p_names->size ())
+                           ? (*p_names)[field] : "f" + std::to_string (field);
+        out.push_back ({station, safe_channel (base + "." + name), received,
+                        (float)number});
+
+        p_next = p_end;
+        while (*p_next == ',' || isspace ((unsigned char)*p_next))
+        {
+            p_next++;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/** @file decode.h
+ *  This file contains functions which turn the weather station's MQTT
+ *  messages into time-stamped samples, one per channel.
+ */
+
+#ifndef _DECODE_H_
+#define _DECODE_H_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/** @brief   One data point destined for one channel's time series.
+ */
+struct Sample
+{
+    std::string station;          ///< First level of the MQTT topic
+    std::string channel;          ///< Rest of the topic plus a field name
+    double t;                     ///< Time (or plot X value) of the point
+    float value;                  ///< The measurement itself
+};
+
+
+/** @brief   Class which decodes station messages into samples.
+ *  @details Three kinds of payload are understood:
+ *           - @c NodeRedPlot JSON, an array holding an object with "series"
+ *             labels and "data" arrays of {"x", "y"} points. Each message
+ *             repeats all the points gathered so far, so only points beyond
+ *             those already seen are returned, and the count starts over when
+ *             a plot comes in shorter than the last one (the station cleared
+ *             it). The first time a plot channel is seen, points whose X is
+ *             no later than the channel's last stored time, as given by the
+ *             function set with @c set_last_time(), are taken as seen, so
+ *             restarting the program doesn't store them twice.
+ *           - A flat JSON object such as a turbulence report. Each number
+ *             becomes a channel named after its key; arrays of numbers become
+ *             channels named @c key_0, @c key_1 and so on.
+ *           - Comma-separated numbers. Field names come from a table set up
+ *             with @c set_fields() for the topic; otherwise the channels are
+ *             named @c f0, @c f1 and so on.
+ *           Samples other than plot points are stamped with the time at which
+ *           the message was received. The station name must be printable and
+ *           can't be @c "." or @c ".."; messages from other topics are
+ *           ignored, as is JSON nested more than @c JSON_MAX_DEPTH deep.
+ *           Slashes and unprintable characters in channel names become
+ *           underscores, as the names are used for file names.
+ */
+/// Deepest nesting of JSON arrays and objects decoded; the station's plot
+/// messages nest five deep, with each point an object in an array of points
+/// in the "data" array of an object in the outer array
+const unsigned JSON_MAX_DEPTH = 8;
+
+
+class Decoder
+{
+protected:
+    /// Points already taken from each plot channel's current data set
+    std::map<std::string, size_t> plot_seen;
+
+    /// Field names for comma-separated messages, by topic suffix
+    std::map<std::string, std::vector<std::string>> csv_fields;
+
+    /// Finds the last time stored for a station's channel
+    std::function<double (const std::string&, const std::string&)> last_time;
+
+public:
+    void set_fields (const std::string& topic_suffix,
+                     const std::vector<std::string>& names);
+    void set_last_time (std::function<double (const std::string&,
+                                              const std::string&)> lookup);
+    void decode (const std::string& topic, const std::string& payload,
+                 double received, std::vector<Sample>& out);
+};
+
+#endif // _DECODE_H_
@@ -0,0 +1,464 @@
+/** @file ingest_test.cpp
+ *  This file contains a test of the ingest program's parts which runs them
+ *  against a broker stub in the same process. The stub sits on one end of a
+ *  socket pair and the MQTT client is attached to the other end. The test
+ *  checks that repeated plot points are stored only once, that comma-separated
+ *  fields get their names, and that a column file grows and reopens intact.
+ *  Hostile topics and payloads are given to the decoder directly, and the
+ *  archive is checked for storing each point once across a restart and for
+ *  keeping its data while it closes and reopens files to stay under a limit.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "archive.h"
+#include "column_file.h"
+#include "decode.h"
+#include "mqtt_client.h"
+
+static int failures = 0;
+
+
+/** @brief   Check that a condition holds, printing a message if it doesn't.
+ */
+#define CHECK(condition, ...)                                                 \
+    do                                                                        \
+    {                                                                         \
+        if (!(condition))                                                     \
+        {                                                                     \
+            printf ("FAILED %s:%d: %s: ", __FILE__, __LINE__, #condition);    \
+            printf (__VA_ARGS__);                                             \
+            printf ("\n");                                                    \
+            failures++;                                                       \
+        }                                                                     \
+    }                                                                         \
+    while (0)
+
+
+/** @brief   Class which plays a broker for one client over a socket.
+ *  @details The stub answers CONNECT, SUBSCRIBE and PINGREQ, and once the
+ *           client has subscribed it publishes a list of messages at QoS 0
+ *           and then closes the connection.
+ */
+class BrokerStub
+{
+protected:
+    int sock;
+    std::vector<std::pair<std::string, std::string>> messages;
+
+    /** @brief   Send one packet with the given fixed header byte and body.
+     */
+    void send_packet (uint8_t header, const std::string& body)
+    {
+        std::string packet (1, (char)header);
+        size_t length = body.size ();
+        do
+        {
+            uint8_t digit = length % 128;
+            length /= 128;
+            packet += (char)(length ? digit | 0x80 : digit);
+        }
+        while (length);
+        packet += body;
+        if (write (sock, packet.data (), packet.size ())
+            != (ssize_t)packet.size ())
+        {
+            perror ("stub write");
+        }
+    }
+
+    /** @brief   Read one whole packet, returning its type or -1 at the end.
+     */
+    int read_packet (std::string& body)
+    {
+        uint8_t header;
+        if (read (sock, &header, 1) != 1)
+        {
+            return -1;
+        }
+        size_t length = 0;
+        uint32_t scale = 1;
+        uint8_t digit;
+        do
+        {
+            if (read (sock, &digit, 1) != 1)
+            {
+                return -1;
+            }
+            length += (digit & 0x7F) * scale;
+            scale *= 128;
+        }
+        while (digit & 0x80);
+
+        body.resize (length);
+        for (size_t got = 0; got < length; )
+        {
+            ssize_t count = read (sock, &body[got], length - got);
+            if (count <= 0)
+            {
+                return -1;
+            }
+            got += count;
+        }
+        return header >> 4;
+    }
+
+public:
+    BrokerStub (int fd) : sock (fd) { }
+
+    void publish_later (const std::string& topic, const std::string& payload)
+    {
+        messages.emplace_back (topic, payload);
+    }
+
+    /** @brief   Serve the client until the messages have all been sent.
+     */
+    void run (void)
+    {
+        std::string body;
+        for (int type; (type = read_packet (body)) >= 0; )
+        {
+            if (type == 1)                              // CONNECT
+            {
+                send_packet (0x20, std::string ("\0\0", 2));
+            }
+            else if (type == 12)                        // PINGREQ
+            {
+                send_packet (0xD0, std::string ());
+            }
+            else if (type == 8)                         // SUBSCRIBE
+            {
+                send_packet (0x90, body.substr (0, 2) + std::string (1, 0));
+                for (const auto& message : messages)
+                {
+                    std::string publish;
+                    publish += (char)(message.first.size () >> 8);
+                    publish += (char)(message.first.size () & 0xFF);
+                    publish += message.first + message.second;
+                    send_packet (0x30, publish);
+                }
+                break;
+            }
+        }
+        ::close (sock);
+    }
+};
+
+
+/** @brief   Make a NodeRedPlot message holding points (x, x * 10) and
+ *           (x, -x) for x from 0 up to @c points - 1.
+ */
+static std::string plot_message (int points)
+{
+    std::string data[2];
+    for (int x = 0; x < points; x++)
+    {
+        const char* comma = x ? "," : "";
+        data[0] += comma + std::string ("{\"x\":") + std::to_string (x)
+                   + ",\"y\":" + std::to_string (x * 10) + "}";
+        data[1] += comma + std::string ("{\"x\":") + std::to_string (x)
+                   + ",\"y\":" + std::to_string (-x) + "}";
+    }
+    return "[{\"series\":[\"Sines\",\"Cosines\"],\"data\":[[" + data[0]
+           + "],[" + data[1] + "]],\"labels\":[\"\"]}]\n";
+}
+
+
+/** @brief   Receive messages through the client from the stub and decode
+ *           them.
+ */
+static void test_decoding (void)
+{
+    int fds[2];
+    if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        perror ("socketpair");
+        failures++;
+        return;
+    }
+
+    // The plot grows by one point, is resent unchanged, then starts over
+    BrokerStub stub (fds[1]);
+    stub.publish_later ("wx1/energy/test", plot_message (2));
+    stub.publish_later ("wx1/energy/test", plot_message (3));
+    stub.publish_later ("wx1/energy/test", plot_message (3));
+    stub.publish_later ("wx1/energy/test", plot_message (1));
+    stub.publish_later ("wx1/weather/test", "12.5,270.0,18.2,21.0,45.0,60000");
+    stub.publish_later ("wx1/other", "1,2");
+    std::thread broker ([&stub] { stub.run (); });
+
+    Decoder decoder;
+    decoder.set_fields ("weather/test", {"wind_speed", "wind_dir", "gust",
+                                         "temperature", "humidity",
+                                         "uptime_ms"});
+    std::vector<Sample> samples;
+    MqttClient client ("ingest_test");
+    client.on_message ([&] (const std::string& topic,
+                            const std::string& payload)
+    {
+        decoder.decode (topic, payload, 1000.0, samples);
+    });
+
+    CHECK (client.attach (fds[0]), "no CONNACK from the stub");
+    CHECK (client.subscribe ("#"), "couldn't subscribe");
+    while (client.poll (1000))
+    {
+    }
+    broker.join ();
+
+    // Plot points: 2 + 1 + 0 + 1 per curve, in order, each stored once
+    std::vector<Sample> sines, cosines, weather, other;
+    for (const Sample& sample : samples)
+    {
+        CHECK (sample.station == "wx1", "station '%s'",
+               sample.station.c_str ());
+        if (sample.channel == "energy.test.Sines")
+        {
+            sines.push_back (sample);
+        }
+        else if (sample.channel == "energy.test.Cosines")
+        {
+            cosines.push_back (sample);
+        }
+        else if (sample.channel.compare (0, 13, "weather.test.") == 0)
+        {
+            weather.push_back (sample);
+        }
+        else
+        {
+            other.push_back (sample);
+        }
+    }
+    const double expected_x[] = {0, 1, 2, 0};
+    CHECK (sines.size () == 4 && cosines.size () == 4,
+           "%zu sine and %zu cosine points, not 4 each", sines.size (),
+           cosines.size ());
+    for (size_t index = 0; index < sines.size () && index < 4; index++)
+    {
+        CHECK (sines[index].t == expected_x[index]
+               && sines[index].value == 10 * expected_x[index],
+               "sine point %zu is (%g, %g)", index, sines[index].t,
+               sines[index].value);
+    }
+
+    // Comma-separated fields named by the table, or numbered if not listed
+    const char* names[] = {"wind_speed", "wind_dir", "gust", "temperature",
+                           "humidity", "uptime_ms"};
+    const float values[] = {12.5, 270.0, 18.2, 21.0, 45.0, 60000};
+    CHECK (weather.size () == 6, "%zu weather fields", weather.size ());
+    for (size_t index = 0; index < weather.size () && index < 6; index++)
+    {
+        CHECK (weather[index].channel
+               == std::string ("weather.test.") + names[index]
+               && weather[index].value == values[index]
+               && weather[index].t == 1000.0,
+               "field %zu is %s = %g", index, weather[index].channel.c_str (),
+               weather[index].value);
+    }
+    CHECK (other.size () == 2 && other[0].channel == "other.f0"
+           && other[1].channel == "other.f1", "unnamed fields misnamed");
+}
+
+
+/** @brief   Fill a column file well past its first capacity, then reopen it
+ *           and check every sample.
+ */
+static void test_column_growth (void)
+{
+    char path[] = "/tmp/ingest_test_XXXXXX";
+    int fd = mkstemp (path);
+    ::close (fd);
+    unlink (path);
+
+    const size_t count = 100000;
+    {
+        ColumnFile column;
+        CHECK (column.open (path), "can't make %s", path);
+        for (size_t index = 0; index < count; index++)
+        {
+            column.append (index * 0.5, (float)index);
+        }
+        CHECK (column.size () == count, "%zu samples stored", column.size ());
+    }
+
+    ColumnFile column;
+    CHECK (column.open (path), "can't reopen %s", path);
+    CHECK (column.size () == count, "%zu samples after reopening",
+           column.size ());
+    size_t wrong = 0;
+    for (size_t index = 0; index < column.size (); index++)
+    {
+        wrong += (column.times ()[index] != index * 0.5
+                  || column.values ()[index] != (float)index) ? 1 : 0;
+    }
+    CHECK (wrong == 0, "%zu samples changed by growing", wrong);
+    CHECK (column.last_time () == (count - 1) * 0.5, "last time %g",
+           column.last_time ());
+    column.close ();
+    unlink (path);
+}
+
+
+/** @brief   Give the decoder topics which would put files outside the data
+ *           directory and JSON nested deeply enough to overflow the stack.
+ */
+static void test_hostile (void)
+{
+    Decoder decoder;
+    std::vector<Sample> samples;
+
+    const char* bad_topics[] = {"../x/y", "./x", "..", "/x", "\001wx/x",
+                                "wx\n/x"};
+    for (const char* topic : bad_topics)
+    {
+        decoder.decode (topic, "1,2", 1000.0, samples);
+        decoder.decode (topic, "{\"a\":1}", 1000.0, samples);
+    }
+    CHECK (samples.empty (), "%zu samples from bad station names",
+           samples.size ());
+
+    decoder.decode ("wx1/evil", "{\"../../x\":1,\"a/b\":2}", 1000.0,
+                    samples);
+    CHECK (samples.size () == 2, "%zu samples from slashed keys",
+           samples.size ());
+    for (const Sample& sample : samples)
+    {
+        CHECK (sample.channel.find ('/') == std::string::npos,
+               "channel '%s' has a slash", sample.channel.c_str ());
+    }
+
+    samples.clear ();
+    decoder.decode ("wx1/deep", std::string (200000, '['), 1000.0, samples);
+    std::string objects;
+    for (int level = 0; level < 100000; level++)
+    {
+        objects += "{\"a\":";
+    }
+    decoder.decode ("wx1/deep", objects + "1", 1000.0, samples);
+    decoder.decode ("wx1/deep", "{\"a\":[[[[[[[[[1]]]]]]]]]}", 1000.0,
+                    samples);
+    CHECK (samples.empty (), "%zu samples from deep JSON", samples.size ());
+}
+
+
+/** @brief   Make a directory in /tmp for a test's files.
+ */
+static std::string temp_dir (void)
+{
+    char path[] = "/tmp/ingest_test_XXXXXX";
+    return mkdtemp (path) ? path : "/tmp";
+}
+
+
+/** @brief   Store a plot, restart the decoder and archive as the program
+ *           would be restarted, and check that only new points are stored.
+ */
+static void test_restart (void)
+{
+    std::string dir = temp_dir ();
+    std::vector<Sample> samples;
+
+    for (int run = 0; run < 2; run++)
+    {
+        Archive archive (dir, dir);
+        Decoder decoder;
+        decoder.set_last_time ([&] (const std::string& station,
+                                    const std::string& channel)
+        {
+            return archive.last_time (station, channel);
+        });
+
+        samples.clear ();
+        decoder.decode ("wx1/energy/test", plot_message (run ? 5 : 3), 0.0,
+                        samples);
+        decoder.decode ("wx1/energy/test", plot_message (run ? 6 : 4), 0.0,
+                        samples);
+        for (const Sample& sample : samples)
+        {
+            archive.store (sample);
+        }
+    }
+
+    ColumnFile column;
+    CHECK (column.open (dir + "/wx1/energy.test.Sines.col"),
+           "can't open the plot's column");
+    CHECK (column.size () == 6, "%zu points stored, not 6", column.size ());
+    for (size_t index = 0; index < column.size (); index++)
+    {
+        CHECK (column.times ()[index] == index, "point %zu has x = %g", index,
+               column.times ()[index]);
+    }
+    column.close ();
+    CHECK (system (("rm -rf " + dir).c_str ()) == 0, "can't remove %s",
+           dir.c_str ());
+}
+
+
+/** @brief   Store into more channels than may be open at once and check that
+ *           no data is lost as files are closed and opened again.
+ */
+static void test_open_limit (void)
+{
+    std::string dir = temp_dir ();
+    const int channels = 10;
+    const int rounds = 5;
+    {
+        Archive archive (dir, dir, 3);
+        for (int round = 0; round < rounds; round++)
+        {
+            for (int channel = 0; channel < channels; channel++)
+            {
+                archive.store ({"wx" + std::to_string (channel % 2),
+                                "c" + std::to_string (channel), (double)round,
+                                (float)(channel * 100 + round)});
+                CHECK (archive.open_files () <= 3, "%zu files open",
+                       archive.open_files ());
+            }
+        }
+        CHECK (archive.render () == channels, "not every plot was drawn");
+        CHECK (archive.open_files () <= 3, "%zu files open after drawing",
+               archive.open_files ());
+    }
+
+    for (int channel = 0; channel < channels; channel++)
+    {
+        ColumnFile column;
+        std::string name = "wx" + std::to_string (channel % 2) + "/c"
+                           + std::to_string (channel);
+        CHECK (column.open (dir + "/" + name + ".col"), "can't open %s",
+               name.c_str ());
+        CHECK (column.size () == rounds, "%s has %zu samples", name.c_str (),
+               column.size ());
+        for (size_t index = 0; index < column.size (); index++)
+        {
+            CHECK (column.values ()[index] == channel * 100 + index,
+                   "%s sample %zu is %g", name.c_str (), index,
+                   column.values ()[index]);
+        }
+    }
+    CHECK (system (("rm -rf " + dir).c_str ()) == 0, "can't remove %s",
+           dir.c_str ());
+}
+
+
+/** @brief   Run the ingest tests.
+ */
+int main (void)
+{
+    test_decoding ();
+    test_column_growth ();
+    test_hostile ();
+    test_restart ();
+    test_open_limit ();
+
+    printf (failures ? "%d checks failed\n" : "All checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+/** @file main.cpp
+ *  This file contains a host program which subscribes to weather stations'
+ *  MQTT topics, stores their data in memory-mapped column files, and keeps a
+ *  set of static SVG plots up to date for a web server to hand out.
+ *
+ *  Usage: wx_ingest [-h host] [-p port] [-t topic_filter]... [-d data_dir]
+ *                   [-o plot_dir] [-i render_interval_s] [-f max_open_files]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "archive.h"
+#include "decode.h"
+#include "mqtt_client.h"
+
+
+/** @brief   Get the wall clock time in seconds since 1970.
+ */
+static double wall_time (void)
+{
+    return std::chrono::duration<double> (
+        std::chrono::system_clock::now ().time_since_epoch ()).count ();
+}
+
+
+/** @brief   Run the ingest program.
+ */
+int main (int argc, char** argv)
+{
+    std::string host = "localhost";
+    uint16_t port = 1883;
+    std::vector<std::string> filters;
+    std::string data_dir = "wx_data";
+    std::string plot_dir = "wx_plots";
+    double render_interval = 5.0;
+    size_t max_open = 256;
+
+    int option;
+    while ((option = getopt (argc, argv, "h:p:t:d:o:i:f:")) != -1)
+    {
+        switch (option)
+        {
+            case 'h': host = optarg; break;
+            case 'p': port = atoi (optarg); break;
+            case 't': filters.push_back (optarg); break;
+            case 'd': data_dir = optarg; break;
+            case 'o': plot_dir = optarg; break;
+            case 'i': render_interval = atof (optarg); break;
+            case 'f': max_open = atoi (optarg); break;
+            default:
+                fprintf (stderr, "Usage: %s [-h host] [-p port] "
+                         "[-t topic_filter]... [-d data_dir] [-o plot_dir] "
+                         "[-i render_interval_s] [-f max_open_files]\n",
+                         argv[0]);
+                return 1;
+        }
+    }
+    if (filters.empty ())
+    {
+        filters.push_back ("#");
+    }
+    if (!make_dir (data_dir) || !make_dir (plot_dir))
+    {
+        fprintf (stderr, "Can't make data or plot directory\n");
+        return 1;
+    }
+
+    Archive archive (data_dir, plot_dir, max_open);
+
+    // The station's current-conditions message is plain comma-separated text;
+    // plot points already stored before a restart aren't stored again
+    Decoder decoder;
+    decoder.set_fields ("weather/test", {"wind_speed", "wind_dir", "gust",
+                                         "temperature", "humidity",
+                                         "uptime_ms"});
+    decoder.set_last_time ([&] (const std::string& station,
+                                const std::string& channel)
+    {
+        return archive.last_time (station, channel);
+    });
+
+    std::vector<Sample> samples;
+    MqttClient client ("wx_ingest_" + std::to_string (getpid ()));
+    client.on_message ([&] (const std::string& topic,
+                            const std::string& payload)
+    {
+        samples.clear ();
+        decoder.decode (topic, payload, wall_time (), samples);
+        for (const Sample& sample : samples)
+        {
+            archive.store (sample);
+        }
+    });
+
+    double next_render = wall_time () + render_interval;
+    int retry_delay = 1;
+    for (;;)
+    {
+        // Connect, or reconnect with a growing delay if the broker's down
+        if (!client.connected ())
+        {
+            if (!client.connect (host, port))
+            {
+                fprintf (stderr, "Can't connect to %s:%u; retry in %d s\n",
+                         host.c_str (), port, retry_delay);
+                std::this_thread::sleep_for (
+                    std::chrono::seconds (retry_delay));
+                retry_delay = retry_delay < 60 ? 2 * retry_delay : 60;
+                continue;
+            }
+            retry_delay = 1;
+            for (const std::string& filter : filters)
+            {
+                client.subscribe (filter);
+            }
+            printf ("Connected to %s:%u\n", host.c_str (), port);
+        }
+
+        double until_render = next_render - wall_time ();
+        client.poll (until_render > 0.0 ? (int)(until_render * 1000) : 0);
+
+        if (wall_time () >= next_render)
+        {
+            archive.render ();
+            next_render = wall_time () + render_interval;
+        }
+    }
+}
@@ -0,0 +1,330 @@
+/** @file mqtt_client.cpp
+ *  This file contains a small MQTT 3.1.1 client which subscribes to topics
+ *  and receives QoS 0 messages on a host computer, using plain POSIX sockets.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "mqtt_client.h"
+
+
+/** @brief   Get a monotonic time in milliseconds.
+ */
+static int64_t now_ms (void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds> (
+        std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+
+/** @brief   Append a length-prefixed UTF-8 string as MQTT encodes them.
+ */
+static void put_string (std::string& out, const std::string& text)
+{
+    out += (char)(text.size () >> 8);
+    out += (char)(text.size () & 0xFF);
+    out += text;
+}
+
+
+/** @brief   Create an MQTT client which isn't yet connected to anything.
+ *  @param   id The client ID to send to the broker
+ *  @param   keep_alive_s The keep-alive interval to request, in seconds
+ */
+MqttClient::MqttClient (const std::string& id, uint16_t keep_alive_s)
+    : sock (-1), client_id (id), keep_alive (keep_alive_s),
+      next_packet_id (1), last_sent_ms (0), connack_rc (-1)
+{
+}
+
+
+/** @brief   Destroy the client, closing its connection if there is one.
+ */
+MqttClient::~MqttClient ()
+{
+    close ();
+}
+
+
+/** @brief   Open a TCP connection to a broker and log in.
+ *  @param   host The broker's host name or IP address
+ *  @param   port The broker's TCP port, usually 1883
+ *  @return  True if the broker accepted the connection
+ */
+bool MqttClient::connect (const std::string& host, uint16_t port)
+{
+    close ();
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* p_list = nullptr;
+    if (getaddrinfo (host.c_str (), std::to_string (port).c_str (), &hints,
+                     &p_list) != 0)
+    {
+        return false;
+    }
+
+    int fd = -1;
+    for (addrinfo* p_addr = p_list; p_addr; p_addr = p_addr->ai_next)
+    {
+        fd = socket (p_addr->ai_family, p_addr->ai_socktype,
+                     p_addr->ai_protocol);
+        if (fd >= 0 && ::connect (fd, p_addr->ai_addr, p_addr->ai_addrlen) == 0)
+        {
+            break;
+        }
+        if (fd >= 0)
+        {
+            ::close (fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo (p_list);
+
+    return fd >= 0 && attach (fd);
+}
+
+
+/** @brief   Log in to a broker over an already connected stream socket.
+ *  @details The client takes ownership of the descriptor and closes it when
+ *           the connection ends.
+ *  @param   fd The connected socket
+ *  @return  True if the broker answered with a successful CONNACK
+ */
+bool MqttClient::attach (int fd)
+{
+    close ();
+    sock = fd;
+    in_buffer.clear ();
+    connack_rc = -1;
+
+    std::string body;
+    put_string (body, "MQTT");
+    body += (char)4;                        // Protocol level 3.1.1
+    body += (char)0x02;                     // Clean session
+    body += (char)(keep_alive >> 8);
+    body += (char)(keep_alive & 0xFF);
+    put_string (body, client_id);
+    if (!send_packet (0x10, body))
+    {
+        return false;
+    }
+
+    // Wait a few seconds for the broker to acknowledge
+    int64_t give_up = now_ms () + 5000;
+    while (connack_rc < 0 && sock >= 0 && now_ms () < give_up)
+    {
+        poll (100);
+    }
+    if (connack_rc != 0)
+    {
+        close ();
+        return false;
+    }
+    return true;
+}
+
+
+/** @brief   Subscribe to a topic filter at QoS 0.
+ *  @param   topic_filter The topic or wildcard filter, such as @c "wx/#"
+ *  @return  True if the request was sent
+ */
+bool MqttClient::subscribe (const std::string& topic_filter)
+{
+    std::string body;
+    body += (char)(next_packet_id >> 8);
+    body += (char)(next_packet_id & 0xFF);
+    next_packet_id = next_packet_id == 0xFFFF ? 1 : next_packet_id + 1;
+    put_string (body, topic_filter);
+    body += (char)0;                        // Requested QoS
+    return send_packet (0x82, body);
+}
+
+
+/** @brief   Send one packet with the given fixed header byte and body.
+ *  @return  True if the whole packet was written
+ */
+bool MqttClient::send_packet (uint8_t header, const std::string& body)
+{
+    if (sock < 0)
+    {
+        return false;
+    }
+
+    std::string packet (1, (char)header);
+    size_t length = body.size ();
+    do
+    {
+        uint8_t digit = length % 128;
+        length /= 128;
+        packet += (char)(length ? digit | 0x80 : digit);
+    }
+    while (length);
+    packet += body;
+
+    const char* p_next = packet.data ();
+    size_t left = packet.size ();
+    while (left)
+    {
+        ssize_t sent = send (sock, p_next, left, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            close ();
+            return false;
+        }
+        p_next += sent;
+        left -= sent;
+    }
+    last_sent_ms = now_ms ();
+    return true;
+}
+
+
+/** @brief   Handle every complete packet in the input buffer.
+ *  @return  False if the broker sent something we can't make sense of
+ */
+bool MqttClient::parse_packets (void)
+{
+    size_t start = 0;
+    for (;;)
+    {
+        // Decode the fixed header, stopping if it isn't all here yet
+        size_t index = start + 1;
+        size_t length = 0;
+        uint32_t scale = 1;
+        bool complete = false;
+        while (index < in_buffer.size () && scale <= 128 * 128 * 128)
+        {
+            uint8_t digit = in_buffer[index++];
+            length += (digit & 0x7F) * scale;
+            scale *= 128;
+            if (!(digit & 0x80))
+            {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete)
+        {
+            if (scale > 128 * 128 * 128)
+            {
+                return false;
+            }
+            break;
+        }
+        if (in_buffer.size () - index < length)
+        {
+            break;
+        }
+
+        uint8_t type = in_buffer[start] >> 4;
+        const uint8_t* p_body = in_buffer.data () + index;
+
+        if (type == 2 && length >= 2)                   // CONNACK
+        {
+            connack_rc = p_body[1];
+        }
+        else if (type == 3 && length >= 2)              // PUBLISH
+        {
+            uint8_t qos = (in_buffer[start] >> 1) & 0x03;
+            size_t topic_len = (p_body[0] << 8) | p_body[1];
+            size_t offset = 2 + topic_len + (qos ? 2 : 0);
+            if (offset > length)
+            {
+                return false;
+            }
+            std::string topic ((const char*)p_body + 2, topic_len);
+            std::string payload ((const char*)p_body + offset,
+                                 length - offset);
+
+            // Acknowledge anything a broker sends at QoS 1 regardless
+            if (qos == 1)
+            {
+                send_packet (0x40, std::string ((const char*)p_body + 2
+                                                + topic_len, 2));
+            }
+            if (handler)
+            {
+                handler (topic, payload);
+            }
+        }
+        start = index + length;
+    }
+
+    in_buffer.erase (in_buffer.begin (), in_buffer.begin () + start);
+    return true;
+}
+
+
+/** @brief   Wait for and handle incoming packets, sending pings as needed.
+ *  @param   timeout_ms The longest time to wait for data, in milliseconds
+ *  @return  True if the connection is still up
+ */
+bool MqttClient::poll (int timeout_ms)
+{
+    if (sock < 0)
+    {
+        return false;
+    }
+
+    // Don't sleep past the time when the next keep-alive ping is due
+    int64_t ping_due = last_sent_ms + keep_alive * 500;
+    int64_t until_ping = ping_due - now_ms ();
+    if (until_ping < timeout_ms)
+    {
+        timeout_ms = until_ping > 0 ? (int)until_ping : 0;
+    }
+
+    pollfd waiting = { sock, POLLIN, 0 };
+    int ready = ::poll (&waiting, 1, timeout_ms);
+    if (ready < 0 && errno != EINTR)
+    {
+        close ();
+        return false;
+    }
+
+    if (ready > 0)
+    {
+        uint8_t chunk[4096];
+        ssize_t got = recv (sock, chunk, sizeof (chunk), 0);
+        if (got <= 0)
+        {
+            close ();
+            return false;
+        }
+        in_buffer.insert (in_buffer.end (), chunk, chunk + got);
+        if (!parse_packets ())
+        {
+            close ();
+            return false;
+        }
+    }
+
+    if (sock >= 0 && now_ms () >= ping_due)
+    {
+        send_packet (0xC0, std::string ());
+    }
+    return sock >= 0;
+}
+
+
+/** @brief   Close the connection to the broker, if it's open.
+ */
+void MqttClient::close (void)
+{
+    if (sock >= 0)
+    {
+        ::close (sock);
+        sock = -1;
+    }
+}
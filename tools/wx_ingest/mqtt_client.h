@@ -0,0 +1,55 @@
+/** @file mqtt_client.h
+ *  This file contains a small MQTT 3.1.1 client which subscribes to topics
+ *  and receives QoS 0 messages on a host computer, using plain POSIX sockets.
+ */
+
+#ifndef _MQTT_CLIENT_H_
+#define _MQTT_CLIENT_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/** @brief   Class which receives messages from an MQTT broker.
+ *  @details Only what an ingest program needs is implemented: connecting,
+ *           subscribing at QoS 0, keep-alive pings and receiving published
+ *           messages. The client can also be attached to an already connected
+ *           file descriptor such as one end of a @c socketpair(), so that it
+ *           can be run against an in-process broker stub.
+ */
+class MqttClient
+{
+public:
+    /// Type of function called with the topic and payload of each message
+    typedef std::function<void (const std::string&, const std::string&)>
+        Handler;
+
+protected:
+    int sock;                           ///< Socket connected to the broker
+    std::string client_id;              ///< ID sent to the broker
+    uint16_t keep_alive;                ///< Keep-alive interval in seconds
+    uint16_t next_packet_id;            ///< ID for the next SUBSCRIBE
+    std::vector<uint8_t> in_buffer;     ///< Bytes received but not yet parsed
+    int64_t last_sent_ms;               ///< When we last sent anything
+    Handler handler;                    ///< Called for each message
+    int connack_rc;                     ///< CONNACK return code, -1 if none
+
+    bool send_packet (uint8_t header, const std::string& body);
+    bool parse_packets (void);
+
+public:
+    MqttClient (const std::string& id, uint16_t keep_alive_s = 60);
+    ~MqttClient ();
+
+    bool connect (const std::string& host, uint16_t port);
+    bool attach (int fd);
+    bool subscribe (const std::string& topic_filter);
+    bool poll (int timeout_ms);
+    void close (void);
+    bool connected (void) const { return sock >= 0; }
+    void on_message (Handler callback) { handler = callback; }
+};
+
+#endif // _MQTT_CLIENT_H_
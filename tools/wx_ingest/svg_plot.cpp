@@ -0,0 +1,145 @@
+/** @file svg_plot.cpp
+ *  This file contains a function which draws one channel's time series as a
+ *  static SVG line plot.
+ */
+
+#include <cstdio>
+#include <ctime>
+#include "svg_plot.h"
+
+
+const int WIDTH = 800;                  ///< Plot width in pixels
+const int HEIGHT = 300;                 ///< Plot height in pixels
+const int LEFT = 60;                    ///< Space for the Y axis labels
+const int BOTTOM = 30;                  ///< Space for the X axis labels
+const int TOP = 30;                     ///< Space for the title
+
+
+/** @brief   Format an X axis value as a clock time if it looks like one.
+ *  @details Samples stamped on arrival hold seconds since 1970; plot points
+ *           from the station hold whatever X values it sent.
+ */
+static std::string x_label (double t)
+{
+    char text[32];
+    if (t > 1.0e9)
+    {
+        time_t seconds = (time_t)t;
+        struct tm local;
+        localtime_r (&seconds, &local);
+        strftime (text, sizeof (text), "%m-%d %H:%M", &local);
+    }
+    else
+    {
+        snprintf (text, sizeof (text), "%g", t);
+    }
+    return text;
+}
+
+
+/** @brief   Escape the characters which mean something in XML text.
+ */
+static std::string xml_escape (const std::string& text)
+{
+    std::string out;
+    for (char letter : text)
+    {
+        switch (letter)
+        {
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '&': out += "&amp;"; break;
+            default: out += letter;
+        }
+    }
+    return out;
+}
+
+
+/** @brief   Draw the latest run of a channel's samples as an SVG line plot.
+ *  @details Only the samples since the time column last went backwards (such
+ *           as when the station cleared and restarted a plot) are drawn, and
+ *           no more than @c max_points of those. The file is written under a
+ *           temporary name and then renamed, so a web server never hands out
+ *           a half-written plot.
+ *  @param   column The channel's time series
+ *  @param   title A title to print above the plot
+ *  @param   path The name of the SVG file to write
+ *  @param   max_points The largest number of points to draw
+ *  @return  True if the file was written
+ */
+bool write_svg_plot (const ColumnFile& column, const std::string& title,
+                     const std::string& path, size_t max_points)
+{
+    const double* t = column.times ();
+    const float* y = column.values ();
+    size_t end = column.size ();
+    size_t first = end > max_points ? end - max_points : 0;
+    for (size_t index = end; index > first + 1; index--)
+    {
+        if (t[index - 1] < t[index - 2])
+        {
+            first = index - 1;
+            break;
+        }
+    }
+    if (first >= end)
+    {
+        return false;
+    }
+
+    // Find the ranges of the data, leaving room if everything's one value
+    double t_min = t[first], t_max = t[end - 1];
+    float y_min = y[first], y_max = y[first];
+    for (size_t index = first; index < end; index++)
+    {
+        y_min = y[index] < y_min ? y[index] : y_min;
+        y_max = y[index] > y_max ? y[index] : y_max;
+    }
+    if (t_max <= t_min)
+    {
+        t_max = t_min + 1.0;
+    }
+    if (y_max <= y_min)
+    {
+        y_min -= 0.5;
+        y_max += 0.5;
+    }
+    double x_scale = (WIDTH - LEFT - 10) / (t_max - t_min);
+    double y_scale = (HEIGHT - TOP - BOTTOM) / (y_max - y_min);
+
+    std::string temp_path = path + ".tmp";
+    FILE* p_file = fopen (temp_path.c_str (), "w");
+    if (!p_file)
+    {
+        return false;
+    }
+
+    fprintf (p_file, "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+             "width=\"%d\" height=\"%d\" font-family=\"sans-serif\" "
+             "font-size=\"11\">\n<rect width=\"100%%\" height=\"100%%\" "
+             "fill=\"white\"/>\n", WIDTH, HEIGHT);
+    fprintf (p_file, "<text x=\"%d\" y=\"18\" font-size=\"14\">%s</text>\n",
+             LEFT, xml_escape (title).c_str ());
+    fprintf (p_file, "<path d=\"M%d %d V%d H%d\" stroke=\"black\" "
+             "fill=\"none\"/>\n", LEFT, TOP, HEIGHT - BOTTOM, WIDTH - 10);
+    fprintf (p_file, "<text x=\"%d\" y=\"%d\" text-anchor=\"end\">%g</text>\n"
+             "<text x=\"%d\" y=\"%d\" text-anchor=\"end\">%g</text>\n",
+             LEFT - 4, TOP + 4, y_max, LEFT - 4, HEIGHT - BOTTOM, y_min);
+    fprintf (p_file, "<text x=\"%d\" y=\"%d\">%s</text>\n"
+             "<text x=\"%d\" y=\"%d\" text-anchor=\"end\">%s</text>\n",
+             LEFT, HEIGHT - 10, x_label (t_min).c_str (),
+             WIDTH - 10, HEIGHT - 10, x_label (t_max).c_str ());
+
+    fprintf (p_file, "<polyline fill=\"none\" stroke=\"steelblue\" "
+             "stroke-width=\"1.5\" points=\"");
+    for (size_t index = first; index < end; index++)
+    {
+        fprintf (p_file, "%.1f,%.1f ", LEFT + (t[index] - t_min) * x_scale,
+                 HEIGHT - BOTTOM - (y[index] - y_min) * y_scale);
+    }
+    fprintf (p_file, "\"/>\n</svg>\n");
+
+    bool ok = fclose (p_file) == 0;
+    return ok && rename (temp_path.c_str (), path.c_str ()) == 0;
+}
@@ -0,0 +1,16 @@
+/** @file svg_plot.h
+ *  This file contains a function which draws one channel's time series as a
+ *  static SVG line plot.
+ */
+
+#ifndef _SVG_PLOT_H_
+#define _SVG_PLOT_H_
+
+#include <string>
+#include "column_file.h"
+
+
+bool write_svg_plot (const ColumnFile& column, const std::string& title,
+                     const std::string& path, size_t max_points = 2000);
+
+#endif // _SVG_PLOT_H_